@@ -0,0 +1,134 @@
+/******************************************************************************
+* @file    Cpu.c
+* @brief   CPU 特性检测与控制寄存器访问相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Cpu.h"
+
+static bool sse2Enabled = false;
+
+/**
+ * @brief 执行 cpuid 指令。
+ *
+ * @param leaf 功能号，写入 EAX。
+ * @param eax,ebx,ecx,edx 返回的四个寄存器的值。
+ */
+void cpu_Id(uint32 leaf, uint32* eax, uint32* ebx, uint32* ecx, uint32* edx)
+{
+    asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+/**
+ * @brief 检测 cpuid 功能号 1 的 EDX 中是否包含指定特性。
+ *
+ * @param feature CPUID_FEATURE_xxx 特性位的组合。
+ * @return bool 所有特性都支持时返回 true。
+ */
+bool cpu_Has_Feature(uint32 feature)
+{
+    uint32 eax, ebx, ecx, edx;
+    cpu_Id(1, &eax, &ebx, &ecx, &edx);
+    return (edx & feature) == feature;
+}
+
+uint32 cpu_Read_Cr0(void)
+{
+    uint32 cr0;
+    asm volatile("mov %%cr0, %0" : "=r"(cr0));
+    return cr0;
+}
+
+void cpu_Write_Cr0(uint32 cr0)
+{
+    asm volatile("mov %0, %%cr0" : : "r"(cr0) : "memory");
+}
+
+uint32 cpu_Read_Cr4(void)
+{
+    uint32 cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+void cpu_Write_Cr4(uint32 cr4)
+{
+    asm volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+/**
+ * @brief 读取时间戳计数器。
+ *
+ * @return uint64 自 CPU 复位以来经过的时钟周期数。
+ */
+uint64 cpu_Read_Tsc(void)
+{
+    uint32 low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64)high << 32) | low;
+}
+
+/**
+ * @brief 检测并开启 SSE2，供整页清零和复制使用。
+ *
+ * 设置 CR4.OSFXSR 和 CR4.OSXMMEXCPT，清除 CR0.EM 并设置 CR0.MP。
+ * 线程切换时不保存 FPU/SSE 状态，内核中使用 XMM 寄存器的代码必须关闭中断，
+ * 并在使用前后保存和恢复用到的寄存器，不能依赖 FXSAVE。
+ *
+ * @return bool 开启成功时返回 true。
+ */
+bool cpu_Enable_Sse2(void)
+{
+    uint32 features = CPUID_FEATURE_FXSR | CPUID_FEATURE_SSE | CPUID_FEATURE_SSE2;
+    if (!cpu_Has_Feature(features))
+    {
+        return false;
+    }
+    cpu_Write_Cr0((cpu_Read_Cr0() & ~CR0_EM) | CR0_MP);
+    cpu_Write_Cr4(cpu_Read_Cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    sse2Enabled = true;
+    return true;
+}
+
+bool cpu_Sse2_Enabled(void)
+{
+    return sse2Enabled;
+}
+
+/**
+ * @brief 读取模型特定寄存器（MSR），调用者需先确认 CPUID_FEATURE_MSR。
+ */
+uint64 cpu_Read_Msr(uint32 msr)
+{
+    uint32 low, high;
+    asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64)high << 32) | low;
+}
+
+void cpu_Write_Msr(uint32 msr, uint64 value)
+{
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32)value), "d"((uint32)(value >> 32)) : "memory");
+}
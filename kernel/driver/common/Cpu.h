@@ -0,0 +1,71 @@
+/******************************************************************************
+* @file    Cpu.h
+* @brief   CPU 特性检测与控制寄存器访问相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef CPU_H
+#define CPU_H
+
+#include "Std_Types.h"
+
+// cpuid 功能号 1 返回的 EDX 特性位
+#define CPUID_FEATURE_PSE             (1 << 3)
+#define CPUID_FEATURE_TSC             (1 << 4)
+#define CPUID_FEATURE_MSR             (1 << 5)
+#define CPUID_FEATURE_APIC            (1 << 9)
+#define CPUID_FEATURE_PGE             (1 << 13)
+#define CPUID_FEATURE_FXSR            (1 << 24)
+#define CPUID_FEATURE_SSE             (1 << 25)
+#define CPUID_FEATURE_SSE2            (1 << 26)
+
+// CR0 控制位，WP 置位后内核态写只读页同样触发页错误，写时复制依赖该位
+#define CR0_WP                        (1 << 16)
+#define CR0_MP                        (1 << 1)
+#define CR0_EM                        (1 << 2)
+
+// CR4 控制位
+#define CR4_PSE                       (1 << 4)
+#define CR4_PGE                       (1 << 7)
+#define CR4_OSFXSR                    (1 << 9)
+#define CR4_OSXMMEXCPT                (1 << 10)
+
+// 本地 APIC 基址寄存器，高 20 位为 APIC 寄存器的物理基址
+#define MSR_APIC_BASE                 0x1B
+#define MSR_APIC_BASE_ENABLE          (1 << 11)
+
+void cpu_Id(uint32 leaf, uint32* eax, uint32* ebx, uint32* ecx, uint32* edx);
+bool cpu_Has_Feature(uint32 feature);
+uint32 cpu_Read_Cr0(void);
+void cpu_Write_Cr0(uint32 cr0);
+uint32 cpu_Read_Cr4(void);
+void cpu_Write_Cr4(uint32 cr4);
+uint64 cpu_Read_Tsc(void);
+uint64 cpu_Read_Msr(uint32 msr);
+void cpu_Write_Msr(uint32 msr, uint64 value);
+bool cpu_Enable_Sse2(void);
+bool cpu_Sse2_Enabled(void);
+
+#endif // !CPU_H
@@ -31,19 +31,116 @@
 
 extern void* get_Ebp();
 
+/**
+ * @brief 将内存区域设置为指定的值。
+ *
+ * 先按字节写到 4 字节对齐，中间部分用 rep stosd 按双字写入，剩余不足 4 字节的部分再按字节写入。
+ *
+ * @param ptr 内存区域的起始地址。
+ * @param value 要写入的字节值。
+ * @param num 字节数。
+ */
 void memset(void* ptr, uint8 value, int num)
 {
-    for (int i = 0; i < num; i++)
+    uint8* dst = (uint8*)ptr;
+    while (((uint32)dst & 3) != 0 && num > 0)
     {
-        *((uint8*)(ptr + i)) = value;
+        *dst++ = value;
+        num--;
+    }
+    if (num <= 0)
+    {
+        return;
+    }
+    uint32 dwords = (uint32)num >> 2;
+    uint32 pattern = value * 0x01010101;
+    asm volatile("cld; rep stosl" : "+D"(dst), "+c"(dwords) : "a"(pattern) : "memory");
+    for (num &= 3; num > 0; num--)
+    {
+        *dst++ = value;
     }
 }
 
+/**
+ * @brief 复制内存区域，源区域和目标区域不能重叠。
+ *
+ * 源地址和目标地址对 4 取余相同时，先按字节复制到对齐，再用 rep movsd 按双字复制；
+ * 否则无法同时对齐，直接使用 rep movsb。
+ *
+ * @param dest 目标地址。
+ * @param src 源地址。
+ * @param num 字节数。
+ */
 void memcpy(void* dest, const void* src, int num)
 {
-    for (int i = 0; i < num; i++)
+    uint8* dst = (uint8*)dest;
+    const uint8* source = (const uint8*)src;
+    if (num <= 0)
+    {
+        return;
+    }
+    if ((((uint32)dst ^ (uint32)source) & 3) == 0)
+    {
+        while (((uint32)dst & 3) != 0 && num > 0)
+        {
+            *dst++ = *source++;
+            num--;
+        }
+        uint32 dwords = (uint32)num >> 2;
+        asm volatile("cld; rep movsl" : "+D"(dst), "+S"(source), "+c"(dwords) : : "memory");
+        num &= 3;
+    }
+    uint32 bytes = (uint32)num;
+    asm volatile("cld; rep movsb" : "+D"(dst), "+S"(source), "+c"(bytes) : : "memory");
+}
+
+/**
+ * @brief 复制内存区域，源区域和目标区域可以重叠。
+ *
+ * 目标区域位于源区域之前或两者不重叠时与 memcpy 相同；否则从高地址向低地址复制，
+ * 对齐部分使用设置方向标志后的 rep movsd，复制完成后立即清除方向标志。
+ *
+ * @param dest 目标地址。
+ * @param src 源地址。
+ * @param num 字节数。
+ */
+void memmove(void* dest, const void* src, int num)
+{
+    uint8* dst = (uint8*)dest;
+    const uint8* source = (const uint8*)src;
+    if (num <= 0 || dst == source)
+    {
+        return;
+    }
+    if (dst < source || dst >= source + num)
+    {
+        memcpy(dest, src, num);
+        return;
+    }
+    dst += num;
+    source += num;
+    if ((((uint32)dst ^ (uint32)source) & 3) == 0)
+    {
+        while (((uint32)dst & 3) != 0 && num > 0)
+        {
+            *--dst = *--source;
+            num--;
+        }
+        uint32 dwords = (uint32)num >> 2;
+        if (dwords > 0)
+        {
+            // 反向复制时 EDI 和 ESI 指向最后一个双字
+            uint8* lastDst = dst - 4;
+            const uint8* lastSource = source - 4;
+            asm volatile("std; rep movsl; cld" : "+D"(lastDst), "+S"(lastSource), "+c"(dwords) : : "memory");
+            dst -= num & ~3;
+            source -= num & ~3;
+        }
+        num &= 3;
+    }
+    while (num-- > 0)
     {
-        *((uint8*)(dest + i)) = *((uint8*)(src + i));
+        *--dst = *--source;
     }
 }
 
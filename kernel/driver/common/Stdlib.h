@@ -33,6 +33,7 @@
 
 void memset(void* ptr, uint8 value, int num);
 void memcpy(void* dest, const void* src, int num);
+void memmove(void* dest, const void* src, int num);
 int32 strcpy(char* dst, const char* src);
 int32 strcmp(const char* str1, const char* str2);
 int strlen(const char* str);
@@ -0,0 +1,123 @@
+/******************************************************************************
+* @file    Apic.c
+* @brief   本地 APIC 及其定时器相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Apic.h"
+#include "Interrupt.h"
+
+static bool apicEnabled = false;
+
+static void apic_Spurious_Handler(isr_params_t params)
+{
+}
+
+/**
+ * @brief 检测并开启本地 APIC。
+ *
+ * 将 APIC 寄存器页以不可缓存的方式映射到 APIC_VIRTUAL，通过伪中断向量寄存器开启 APIC，
+ * 本地中断引脚保持 BIOS 的设置，8259A 的中断仍经由 LINT0 送达。定时器初始时被屏蔽。
+ * 必须在分页初始化之后调用。
+ *
+ * @return bool CPU 不支持本地 APIC 时返回 false。
+ */
+bool apic_Init(void)
+{
+    if (!cpu_Has_Feature(CPUID_FEATURE_APIC | CPUID_FEATURE_MSR))
+    {
+        return false;
+    }
+    uint64 base = cpu_Read_Msr(MSR_APIC_BASE);
+    uint32 frame = (uint32)base >> 12;
+    if (!map_Page_Frame(APIC_VIRTUAL, frame, PAGE_RW | PAGE_NOCACHE))
+    {
+        monitor_Printf("apic: couldn't map registers at %x\n", frame << 12);
+        return false;
+    }
+    cpu_Write_Msr(MSR_APIC_BASE, base | MSR_APIC_BASE_ENABLE);
+    // 接收所有优先级的中断
+    apic_Write(APIC_REG_TPR, 0);
+    apic_Write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_INT_NUM);
+    apic_Write(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+    register_Interrupt_Handler(APIC_SPURIOUS_INT_NUM, &apic_Spurious_Handler);
+    apic_Write(APIC_REG_SVR, APIC_SVR_ENABLE | APIC_SPURIOUS_INT_NUM);
+    apicEnabled = true;
+    monitor_Printf("apic: id %d, version %x at %x\n",
+        apic_Read(APIC_REG_ID) >> 24, apic_Read(APIC_REG_VERSION) & 0xFF, frame << 12);
+    return true;
+}
+
+bool apic_Enabled(void)
+{
+    return apicEnabled;
+}
+
+uint32 apic_Read(uint32 reg)
+{
+    return *(volatile uint32*)(APIC_VIRTUAL + reg);
+}
+
+void apic_Write(uint32 reg, uint32 value)
+{
+    *(volatile uint32*)(APIC_VIRTUAL + reg) = value;
+}
+
+/**
+ * @brief 通知本地 APIC 中断处理结束，伪中断不需要调用。
+ */
+void apic_Eoi(void)
+{
+    apic_Write(APIC_REG_EOI, 0);
+}
+
+/**
+ * @brief 将 APIC 定时器设置为周期模式，每计数 count 次触发一次 APIC_TIMER_INT_NUM 中断。
+ */
+void apic_Timer_Periodic(uint32 count)
+{
+    apic_Write(APIC_REG_LVT_TIMER, APIC_LVT_TIMER_PERIODIC | APIC_TIMER_INT_NUM);
+    apic_Write(APIC_REG_TIMER_INIT, count);
+}
+
+/**
+ * @brief 将 APIC 定时器设置为单次模式，计数 count 次后触发一次中断并停止。
+ *
+ * @param count 计数值，为 0 时停止定时器。
+ */
+void apic_Timer_One_Shot(uint32 count)
+{
+    apic_Write(APIC_REG_LVT_TIMER, APIC_TIMER_INT_NUM);
+    apic_Write(APIC_REG_TIMER_INIT, count);
+}
+
+/**
+ * @brief 读取 APIC 定时器的剩余计数。
+ */
+uint32 apic_Timer_Current(void)
+{
+    return apic_Read(APIC_REG_TIMER_CURRENT);
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+* @file    Apic.h
+* @brief   本地 APIC 及其定时器相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef APIC_H
+#define APIC_H
+
+#include "Std_Types.h"
+#include "Cpu.h"
+#include "Page_Table.h"
+
+// 本地 APIC 寄存器相对基址的偏移
+#define APIC_REG_ID                 0x020
+#define APIC_REG_VERSION            0x030
+#define APIC_REG_TPR                0x080
+#define APIC_REG_EOI                0x0B0
+#define APIC_REG_SVR                0x0F0
+#define APIC_REG_LVT_TIMER          0x320
+#define APIC_REG_TIMER_INIT         0x380
+#define APIC_REG_TIMER_CURRENT      0x390
+#define APIC_REG_TIMER_DIVIDE       0x3E0
+
+// 伪中断向量寄存器的软件使能位
+#define APIC_SVR_ENABLE             (1 << 8)
+// 本地向量表项的屏蔽位和定时器的周期模式位
+#define APIC_LVT_MASKED             (1 << 16)
+#define APIC_LVT_TIMER_PERIODIC     (1 << 17)
+// 定时器以总线时钟 16 分频计数
+#define APIC_TIMER_DIVIDE_16        0x3
+
+bool apic_Init(void);
+bool apic_Enabled(void);
+uint32 apic_Read(uint32 reg);
+void apic_Write(uint32 reg, uint32 value);
+void apic_Eoi(void);
+void apic_Timer_Periodic(uint32 count);
+void apic_Timer_One_Shot(uint32 count);
+uint32 apic_Timer_Current(void);
+
+#endif // !APIC_H
@@ -27,6 +27,7 @@
 * Contents         :
 ******************************************************************************/
 #include "Interrupt.h"
+#include "Apic.h"
 
 extern void reload_Idt(uint32 idtPtrAddress);
 
@@ -151,7 +152,8 @@ void idt_Init(void)
     set_Idt_Entry(5, (uint32)isr5, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(6, (uint32)isr6, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(7, (uint32)isr7, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
-    set_Idt_Entry(8, (uint32)isr8, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
+    // 双重错误使用任务门，在独立的 TSS 和栈上处理
+    set_Idt_Entry(8, 0, SELECTOR_DOUBLE_FAULT_TSS, IDT_GATE_ATTR_TASK);
     set_Idt_Entry(9, (uint32)isr9, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(10, (uint32)isr10, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(11, (uint32)isr11, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
@@ -192,6 +194,9 @@ void idt_Init(void)
     set_Idt_Entry(45, (uint32)isr45, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(46, (uint32)isr46, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     set_Idt_Entry(47, (uint32)isr47, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
+    // 本地 APIC 中断
+    set_Idt_Entry(APIC_TIMER_INT_NUM, (uint32)isr48, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
+    set_Idt_Entry(APIC_SPURIOUS_INT_NUM, (uint32)isr63, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
     // 预留系统调用中断向量，当前注释掉，后续可根据需要启用
     // set_Idt_Entry(SYSCALL_INT_NUM, (uint32)isr_48, SELECTOR_KERNEL_CODE, IDT_GATE_ATTR_DPL3);
 
@@ -232,6 +237,15 @@ void isr_Handler(isr_params_t params)
         io_Out_Byte(0x20, 0x20);
         inIrqFLag = true;
     }
+    else if (intNum == APIC_TIMER_INT_NUM || intNum == APIC_SPURIOUS_INT_NUM)
+    {
+        // 本地 APIC 的中断同样是硬件中断，伪中断没有置位服务寄存器，不能发送 EOI
+        if (intNum == APIC_TIMER_INT_NUM)
+        {
+            apic_Eoi();
+        }
+        inIrqFLag = true;
+    }
     else
     {
         // 仅在处理硬件中断时关闭中断，处理异常和软件中断均开启中断
@@ -40,6 +40,7 @@
 #define IDT_GATE_DPL0  0
 #define IDT_GATE_DPL3  3
 #define IDT_GATE_32_TYPE  0xE
+#define IDT_GATE_TASK_TYPE  0x5
 
 #define IDT_GATE_ATTR_DPL0 \
   ((IDT_GATE_P << 7) + (IDT_GATE_DPL0 << 5) + IDT_GATE_32_TYPE)
@@ -47,6 +48,9 @@
 #define IDT_GATE_ATTR_DPL3 \
   ((IDT_GATE_P << 7) + (IDT_GATE_DPL3 << 5) + IDT_GATE_32_TYPE)
 
+#define IDT_GATE_ATTR_TASK \
+  ((IDT_GATE_P << 7) + (IDT_GATE_DPL0 << 5) + IDT_GATE_TASK_TYPE)
+
 #define IRQ0_INT_NUM 32
 #define IRQ1_INT_NUM 33
 #define IRQ2_INT_NUM 34
@@ -64,6 +68,10 @@
 #define IRQ14_INT_NUM 46
 #define IRQ15_INT_NUM 47
 
+// 本地 APIC 的中断向量，伪中断向量的低 4 位在早期处理器上固定为 1
+#define APIC_TIMER_INT_NUM    48
+#define APIC_SPURIOUS_INT_NUM 63
+
 #define SYSCALL_INT_NUM 0x80
 
 
@@ -186,6 +194,8 @@ extern void isr44();
 extern void isr45();
 extern void isr46();
 extern void isr47();
+extern void isr48();
+extern void isr63();
 
 
 void enable_Interrupt(void);
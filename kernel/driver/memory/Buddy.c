@@ -0,0 +1,365 @@
+/******************************************************************************
+* @file    Buddy.c
+* @brief   伙伴系统物理页分配器相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Buddy.h"
+#include "Math.h"
+#include "Debug.h"
+
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
+
+// 帧描述符数组由 page_Table_Init 按实际的物理内存大小分配
+static page_frame_t *frameTable = nullptr;
+static uint32 frameNum = 0;
+static free_area_t freeArea[BUDDY_ORDER_NUM];
+// 第 i 位为 1 表示第 i 阶的空闲链表非空
+static uint32 freeAreaMap;
+static uint32 freeFrames;
+
+static uint32 frame_Index(page_frame_t *frame)
+{
+    return (uint32)(frame - frameTable);
+}
+
+static void free_Area_Push(uint32 order, page_frame_t *frame)
+{
+    frame->order = order;
+    frame->flags = PAGE_FRAME_FREE;
+    frame->prev = nullptr;
+    frame->next = freeArea[order].head;
+    if (freeArea[order].head != nullptr)
+    {
+        freeArea[order].head->prev = frame;
+    }
+    freeArea[order].head = frame;
+    freeArea[order].freeNum++;
+    freeAreaMap |= (1 << order);
+}
+
+static void free_Area_Remove(uint32 order, page_frame_t *frame)
+{
+    if (frame->prev != nullptr)
+    {
+        frame->prev->next = frame->next;
+    }
+    else
+    {
+        freeArea[order].head = frame->next;
+    }
+    if (frame->next != nullptr)
+    {
+        frame->next->prev = frame->prev;
+    }
+    frame->flags = 0;
+    freeArea[order].freeNum--;
+    if (freeArea[order].head == nullptr)
+    {
+        freeAreaMap &= ~(1 << order);
+    }
+}
+
+/**
+ * @brief 将块归还到伙伴系统，并尽可能与伙伴块合并。
+ *
+ * 阶为 order 的块的伙伴块帧号为 frame ^ (1 << order)，
+ * 伙伴块空闲且阶相同时合并为 order + 1 阶的块，直到无法合并或达到最大阶。
+ */
+static void free_Block(uint32 frame, uint32 order)
+{
+    // 合并后只有最低地址的帧是首帧，其余帧的标志必须清除，否则之后释放块内部的帧不会被发现
+    frameTable[frame].flags = 0;
+    while (order < BUDDY_MAX_ORDER)
+    {
+        uint32 buddy = frame ^ (1 << order);
+        if (buddy >= frameNum)
+        {
+            break;
+        }
+        page_frame_t *buddyFrame = &frameTable[buddy];
+        if (!(buddyFrame->flags & PAGE_FRAME_FREE) || buddyFrame->order != order)
+        {
+            break;
+        }
+        free_Area_Remove(order, buddyFrame);
+        frame = min(frame, buddy);
+        order++;
+    }
+    free_Area_Push(order, &frameTable[frame]);
+}
+
+/**
+ * @brief 初始化伙伴系统。
+ *
+ * 位图中值为 0 的帧视为可用，逐个归还到伙伴系统，相邻的空闲帧会自动合并成高阶块。
+ * 其余的帧视为启动前已分配的 0 阶块，之后可以通过 buddy_Free_Pages 逐帧归还。
+ *
+ * @param frameMap 物理帧位图，已占用的帧（内核、页表等）对应的位必须为 1，位数即管理的帧数。
+ * @param table 帧描述符数组，至少包含 frameMap->bits 项。
+ */
+void buddy_Init(bitmap_t* frameMap, page_frame_t* table)
+{
+    frameTable = table;
+    frameNum = frameMap->bits;
+    for (uint32 i = 0; i < BUDDY_ORDER_NUM; i++)
+    {
+        freeArea[i].head = nullptr;
+        freeArea[i].freeNum = 0;
+    }
+    freeAreaMap = 0;
+    freeFrames = 0;
+    for (uint32 i = 0; i < frameNum; i++)
+    {
+        frameTable[i].prev = nullptr;
+        frameTable[i].next = nullptr;
+        frameTable[i].order = 0;
+        frameTable[i].flags = 0;
+        frameTable[i].shareCount = 0;
+    }
+    for (uint32 i = 0; i < frameNum; i++)
+    {
+        if (!bitmap_Get_Bit(frameMap, i))
+        {
+            free_Block(i, 0);
+            freeFrames++;
+        }
+        else
+        {
+            frameTable[i].flags = PAGE_FRAME_HEAD;
+        }
+    }
+}
+
+/**
+ * @brief 分配 2^order 个物理上连续的帧。
+ *
+ * 通过 freeAreaMap 和 bsf 指令直接找到不小于 order 的第一个非空阶，
+ * 取出一个块后将多余的部分逐级对半拆分，高地址的一半放回低一阶的空闲链表。
+ *
+ * @param order 块的阶，取值范围为 0 到 BUDDY_MAX_ORDER。
+ * @return int32 块的首帧帧号，内存不足时返回 -1。
+ */
+int32 buddy_Alloc_Pages(uint32 order)
+{
+    if (order > BUDDY_MAX_ORDER)
+    {
+        return -1;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    int32 currentOrder = bit_Scan_Forward(freeAreaMap & ~((1 << order) - 1));
+    if (currentOrder < 0)
+    {
+        set_Eflags(eflags);
+        return -1;
+    }
+    page_frame_t *frame = freeArea[currentOrder].head;
+    free_Area_Remove(currentOrder, frame);
+    uint32 index = frame_Index(frame);
+    while (currentOrder > order)
+    {
+        currentOrder--;
+        free_Area_Push(currentOrder, &frameTable[index + (1 << currentOrder)]);
+    }
+    frame->order = order;
+    frame->flags = PAGE_FRAME_HEAD;
+    freeFrames -= (1 << order);
+    set_Eflags(eflags);
+    return (int32)index;
+}
+
+/**
+ * @brief 释放由 buddy_Alloc_Pages 分配的块。
+ *
+ * 帧必须是一个已分配块的首帧，且阶与分配时一致，否则打印错误并忽略，
+ * 避免重复释放或释放块内部的帧破坏空闲链表。
+ *
+ * @param frame 块的首帧帧号。
+ * @param order 分配时使用的阶。
+ */
+void buddy_Free_Pages(uint32 frame, uint32 order)
+{
+    if (frame >= frameNum || order > BUDDY_MAX_ORDER || (frame & ((1 << order) - 1)) != 0)
+    {
+        monitor_Printf("buddy: invalid free frame %x order %d\n", frame, order);
+        return;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (frameTable[frame].flags & PAGE_FRAME_FREE)
+    {
+        set_Eflags(eflags);
+        monitor_Printf("buddy: double free frame %x\n", frame);
+        return;
+    }
+    if (!(frameTable[frame].flags & PAGE_FRAME_HEAD) || frameTable[frame].order != order)
+    {
+        uint32 headOrder = frameTable[frame].order;
+        set_Eflags(eflags);
+        monitor_Printf("buddy: free frame %x order %d is not an allocated block of that order (%d)\n",
+            frame, order, headOrder);
+        return;
+    }
+    free_Block(frame, order);
+    freeFrames += (1 << order);
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 将一个已分配的块拆分为 2^order 个独立的 0 阶块，之后可以逐帧释放。
+ *
+ * 用于将 4MB 大页拆分为 4KB 页，拆分后的每一帧都可以单独通过 buddy_Free_Pages 归还。
+ *
+ * @param frame 块的首帧帧号。
+ * @param order 分配时使用的阶。
+ */
+void buddy_Split_Pages(uint32 frame, uint32 order)
+{
+    if (frame >= frameNum || order > BUDDY_MAX_ORDER || frame + (1 << order) > frameNum)
+    {
+        monitor_Printf("buddy: invalid split frame %x order %d\n", frame, order);
+        return;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (!(frameTable[frame].flags & PAGE_FRAME_HEAD) || frameTable[frame].order != order)
+    {
+        set_Eflags(eflags);
+        monitor_Printf("buddy: split frame %x order %d is not an allocated block of that order\n", frame, order);
+        return;
+    }
+    for (uint32 i = 0; i < (1u << order); i++)
+    {
+        frameTable[frame + i].order = 0;
+        frameTable[frame + i].flags = PAGE_FRAME_HEAD;
+    }
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 为一个已分配的帧增加一个共享映射，用于写时复制。
+ *
+ * @param frame 帧号。
+ */
+void buddy_Get_Frame(uint32 frame)
+{
+    if (frame >= frameNum)
+    {
+        return;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    frameTable[frame].shareCount++;
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 移除帧的一个映射，最后一个映射被移除时将帧归还给伙伴系统。
+ *
+ * 新分配的帧只有一个映射，shareCount 为 0，因此未共享过的帧会被直接释放。
+ *
+ * @param frame 帧号。
+ * @return bool 帧被释放时返回 true，仍有其他映射时返回 false。
+ */
+bool buddy_Put_Frame(uint32 frame)
+{
+    if (frame >= frameNum)
+    {
+        buddy_Free_Pages(frame, 0);
+        return false;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (frameTable[frame].shareCount > 0)
+    {
+        frameTable[frame].shareCount--;
+        set_Eflags(eflags);
+        return false;
+    }
+    set_Eflags(eflags);
+    buddy_Free_Pages(frame, 0);
+    return true;
+}
+
+uint32 buddy_Frame_Share_Count(uint32 frame)
+{
+    return frameTable[frame].shareCount;
+}
+
+uint32 buddy_Free_Count(uint32 order)
+{
+    if (order > BUDDY_MAX_ORDER)
+    {
+        return 0;
+    }
+    return freeArea[order].freeNum;
+}
+
+uint32 buddy_Free_Frames(void)
+{
+    return freeFrames;
+}
+
+void buddy_Dump(void)
+{
+    monitor_Printf("buddy: %d free frames\n", freeFrames);
+    for (uint32 i = 0; i < BUDDY_ORDER_NUM; i++)
+    {
+        monitor_Printf("  order %d: %d\n", i, freeArea[i].freeNum);
+    }
+}
+
+void buddy_Test(void)
+{
+    monitor_Printf("buddy_Test\n");
+    uint32 before = buddy_Free_Frames();
+    int32 a = buddy_Alloc_Pages(0);
+    int32 b = buddy_Alloc_Pages(3);
+    int32 c = buddy_Alloc_Pages(BUDDY_MAX_ORDER);
+    ASSERT(a >= 0 && b >= 0 && c >= 0);
+    // 高阶块的首帧按其大小对齐
+    ASSERT((b & 7) == 0 && (c & ((1 << BUDDY_MAX_ORDER) - 1)) == 0);
+    ASSERT(buddy_Free_Frames() == before - 1 - 8 - (1 << BUDDY_MAX_ORDER));
+    buddy_Free_Pages(a, 0);
+    buddy_Free_Pages(b, 3);
+    // 阶不匹配或块内部的帧被拒绝，不改变空闲帧数
+    buddy_Free_Pages(c, BUDDY_MAX_ORDER - 1);
+    buddy_Free_Pages(b + 1, 0);
+    ASSERT(buddy_Free_Frames() == before - (1 << BUDDY_MAX_ORDER));
+    // 拆分后的块逐帧释放
+    buddy_Split_Pages(c, BUDDY_MAX_ORDER);
+    for (uint32 i = 0; i < (1u << BUDDY_MAX_ORDER); i++)
+    {
+        buddy_Free_Pages(c + i, 0);
+    }
+    ASSERT(buddy_Free_Frames() == before);
+    // 合并后块内部的帧不再是首帧，再次释放被拒绝
+    buddy_Free_Pages(c + 1, 0);
+    ASSERT(buddy_Free_Frames() == before);
+    buddy_Dump();
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+* @file    Buddy.h
+* @brief   伙伴系统物理页分配器相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef BUDDY_H
+#define BUDDY_H
+
+#include "Std_Types.h"
+#include "Page_Table.h"
+#include "Bitmap.h"
+
+// 最大阶为 10，即一次最多分配 1024 个连续的物理帧（4MB）
+#define BUDDY_MAX_ORDER         10
+#define BUDDY_ORDER_NUM         (BUDDY_MAX_ORDER + 1)
+
+#define PAGE_FRAME_FREE         (1 << 0)    /**< 帧是一个空闲块的首帧。 */
+#define PAGE_FRAME_HEAD         (1 << 1)    /**< 帧是一个已分配块的首帧。 */
+
+/**
+ * @struct page_frame
+ * @brief 每个物理帧对应一个描述符，空闲块的首帧通过 prev/next 挂在对应阶的空闲链表上。
+ */
+struct page_frame
+{
+    struct page_frame *prev;
+    struct page_frame *next;
+    uint8 order;                    /**< 所在块的阶，仅对块的首帧有效。 */
+    uint8 flags;                    /**< PAGE_FRAME_FREE 或 PAGE_FRAME_HEAD。 */
+    uint16 shareCount;              /**< 除第一个映射外共享该帧的映射数量，写时复制时使用。 */
+};
+typedef struct page_frame page_frame_t;
+
+/**
+ * @struct free_area
+ * @brief 某一阶的空闲块链表。
+ */
+struct free_area
+{
+    page_frame_t *head;
+    uint32 freeNum;                 /**< 该阶空闲块的数量。 */
+};
+typedef struct free_area free_area_t;
+
+void buddy_Init(bitmap_t* frameMap, page_frame_t* table);
+int32 buddy_Alloc_Pages(uint32 order);
+void buddy_Free_Pages(uint32 frame, uint32 order);
+void buddy_Split_Pages(uint32 frame, uint32 order);
+void buddy_Get_Frame(uint32 frame);
+bool buddy_Put_Frame(uint32 frame);
+uint32 buddy_Frame_Share_Count(uint32 frame);
+uint32 buddy_Free_Count(uint32 order);
+uint32 buddy_Free_Frames(void);
+void buddy_Dump(void);
+void buddy_Test(void);
+
+#endif // !BUDDY_H
@@ -31,14 +31,17 @@
 
 extern void load_Gdt(gdt_ptr_t* gdt_ptr);
 extern void refresh_Tss();
+extern void double_Fault_Task();
 
 static gdt_ptr_t gdtPtr;
 /* 
- * 定义了7个GDT段描述符
- * 分别是预留段、内核代码段、内核数据段、video段、用户代码段、用户数据段、TSS段
+ * 定义了8个GDT段描述符
+ * 分别是预留段、内核代码段、内核数据段、video段、用户代码段、用户数据段、TSS段、双重错误任务的TSS段
 */
-static gdt_entry_t gdtEntries[7];
+static gdt_entry_t gdtEntries[8];
 static tss_entry_t tssEntry;
+static tss_entry_t doubleFaultTss;
+static uint8 doubleFaultStack[DOUBLE_FAULT_STACK_SIZE] __attribute__((aligned(16)));
 
 /**
  * @brief 刷新全局描述符表（GDT）。
@@ -96,11 +99,39 @@ static void set_Tss(uint32 num, uint16 ss0, uint32 esp0)
     tssEntry.ds = SELECTOR_KERNEL_DATA | RPL3;
     tssEntry.es = SELECTOR_KERNEL_DATA | RPL3;
     tssEntry.fs = SELECTOR_KERNEL_DATA | RPL3;
+    // 进入双重错误任务时 CPU 不保存 CR3，返回时从这里加载，需要始终与当前页目录一致
+    asm volatile("mov %%cr3, %0" : "=r"(tssEntry.cr3));
     base = (uint32)&tssEntry;
-    limit = base + sizeof(tssEntry);
+    limit = sizeof(tssEntry) - 1;
     set_Gdt(num, base, limit, DESC_P | DESC_DPL_0 | DESC_S_SYS | DESC_TYPE_TSS, 0x0);
 }
 
+/**
+ * @brief 设置双重错误任务的 TSS。
+ *
+ * 双重错误通过任务门进入，由 CPU 切换到独立的栈上运行，
+ * 即使内核栈已经不可用（例如内核栈溢出到保护页时无法压入异常帧）也能得到处理。
+ *
+ * @param num GDT 表中的索引位置。
+ */
+static void set_Double_Fault_Tss(uint32 num)
+{
+    memset(&doubleFaultTss, 0, sizeof(tss_entry_t));
+    doubleFaultTss.cr3 = tssEntry.cr3;
+    doubleFaultTss.eip = (uint32)double_Fault_Task;
+    // 只设置必须为 1 的保留位，处理期间关闭中断
+    doubleFaultTss.eflags = 0x2;
+    doubleFaultTss.esp = (uint32)doubleFaultStack + DOUBLE_FAULT_STACK_SIZE;
+    doubleFaultTss.cs = SELECTOR_KERNEL_CODE;
+    doubleFaultTss.ss = SELECTOR_KERNEL_DATA;
+    doubleFaultTss.ds = SELECTOR_KERNEL_DATA;
+    doubleFaultTss.es = SELECTOR_KERNEL_DATA;
+    doubleFaultTss.fs = SELECTOR_KERNEL_DATA;
+    doubleFaultTss.gs = SELECTOR_KERNEL_DATA;
+    doubleFaultTss.io_map_base = sizeof(tss_entry_t);
+    set_Gdt(num, (uint32)&doubleFaultTss, sizeof(tss_entry_t) - 1, DESC_P | DESC_DPL_0 | DESC_S_SYS | DESC_TYPE_TSS, 0x0);
+}
+
 /**
  * @brief 初始化全局描述符表（GDT）和任务状态段（TSS）。
  * 
@@ -111,8 +142,8 @@ static void set_Tss(uint32 num, uint16 ss0, uint32 esp0)
 void gdt_Init()
 {
     // 计算 GDT 表的界限值，即 GDT 表的总字节数减 1。
-    // 因为 GDT 表有 7 个描述符，每个描述符大小为 sizeof(gdt_entry_t)，界限值表示表的最大偏移量。
-    gdtPtr.limit = sizeof(gdt_entry_t) * 7 - 1;
+    // 因为 GDT 表有 8 个描述符，每个描述符大小为 sizeof(gdt_entry_t)，界限值表示表的最大偏移量。
+    gdtPtr.limit = sizeof(gdt_entry_t) * 8 - 1;
     // 设置 GDT 指针的基地址，指向 GDT 表在内存中的起始地址。
     gdtPtr.base = (uint32)&gdtEntries;
 
@@ -136,6 +167,8 @@ void gdt_Init()
     // 设置 GDT 表的第 6 项为 TSS 段。
     // 内核数据段选择子为 0x10，栈指针为 0。TSS 用于保存任务的上下文信息。
     set_Tss(6, 0x10, 0);
+    // 设置 GDT 表的第 7 项为双重错误任务的 TSS 段，由 IDT 中的任务门引用。
+    set_Double_Fault_Tss(7);
 
     // 调用 refresh_Gdt 函数，将配置好的 GDT 加载到 CPU 的 GDTR 寄存器中，使其生效。
     refresh_Gdt();
@@ -146,4 +179,23 @@ void gdt_Init()
 void updateTssEsp(uint32 esp)
 {
     tssEntry.esp0 = esp;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 切换页目录后同步两个 TSS 中的 CR3。
+ *
+ * 双重错误任务切换进来时使用 doubleFaultTss.cr3，返回被中断的任务时 CPU 从 tssEntry.cr3
+ * 重新加载页目录，两者都必须是当前的页目录。
+ *
+ * @param cr3 当前页目录的物理地址。
+ */
+void updateTssCr3(uint32 cr3)
+{
+    tssEntry.cr3 = cr3;
+    doubleFaultTss.cr3 = cr3;
+}
+
+tss_entry_t* get_Tss(void)
+{
+    return &tssEntry;
+}
@@ -65,6 +65,11 @@
 #define SELECTOR_VIDEO          ((3 << 3) | (TI_GDT << 2) | RPL0)
 #define SELECTOR_USER_CODE      ((4 << 3) | (TI_GDT << 2) | RPL3)
 #define SELECTOR_USER_DATA      ((5 << 3) | (TI_GDT << 2) | RPL3)
+#define SELECTOR_TSS            ((6 << 3) | (TI_GDT << 2) | RPL0)
+#define SELECTOR_DOUBLE_FAULT_TSS ((7 << 3) | (TI_GDT << 2) | RPL0)
+
+// 双重错误任务使用的独立栈，发生双重错误时当前栈可能已经不可用
+#define DOUBLE_FAULT_STACK_SIZE 8192
 
 
 /*
@@ -132,4 +137,6 @@ typedef struct tss_entry tss_entry_t;
 
 void gdt_Init();
 void updateTssEsp(uint32 esp);
+void updateTssCr3(uint32 cr3);
+tss_entry_t* get_Tss(void);
 #endif
\ No newline at end of file
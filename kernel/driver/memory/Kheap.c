@@ -28,9 +28,38 @@
 ******************************************************************************/
 #include "Kheap.h"
 #include "Yieldlock.h"
+#include "Slab.h"
+#include "Vmalloc.h"
+#include "Linked_List.h"
+#include "Hash_Table.h"
+
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
 
 static kernel_heap_t kheap;
 static yieldlock_t kheapLock;
+// 累加的计数器，快照相关的字段在 kheap_Get_Stats 中计算
+static kheap_stats_t kheapStats;
+// 没有 TSC 的处理器上执行 rdtsc 会触发 #UD，初始化时检测一次，不支持时不统计周期数
+static bool kheapTsc = false;
+
+/**
+ * @struct kmag_depot
+ * @brief 一个级别的全局 magazine 仓库。
+ */
+typedef struct kmag_depot
+{
+    kmag_magazine_t *full;          /**< 非空的 magazine。 */
+    kmag_magazine_t *empty;         /**< 空的 magazine。 */
+    uint32 fullNum;
+    uint32 emptyNum;
+    yieldlock_t lock;
+} kmag_depot_t;
+
+static kmag_cpu_cache_t kmagCpus[KMAG_CPU_NUM][KMAG_CLASS_NUM];
+static kmag_depot_t kmagDepots[KMAG_CLASS_NUM];
+static kmem_cache_t *kmagCache = nullptr;
+static bool kmagReady = false;
 
 static int32 kheap_Block_Compare(void *a, void *b)
 {
@@ -97,65 +126,292 @@ static uint32 align_Page(uint32 num)
 }
 
 /**
- * @brief 查找满足条件的空闲堆块。
+ * @brief 计算小空闲块所属的链表级别。
+ *
+ * 第 i 级链表保存数据区大小在 [2^(i+3), 2^(i+4)) 范围内的空闲块，
+ * 通过 bsr 指令直接得到最高位，无需逐级比较。
+ *
+ * @param size 空闲块数据区大小，必须小于 KHEAP_LARGE_BLOCK_SIZE。
+ * @return uint32 链表级别。
+ */
+static uint32 bin_Index(uint32 size)
+{
+    return (uint32)bit_Scan_Reverse(size) - KHEAP_BIN_MIN_SHIFT;
+}
+
+static kheap_free_node_t* get_Free_Node(kheap_block_header_t *header)
+{
+    return (kheap_free_node_t *)((uint32)header + HEADER_SIZE);
+}
+
+/**
+ * @brief 将空闲块加入对应的空闲链表或大空闲块索引。
+ *
+ * 小于 KHEAP_LARGE_BLOCK_SIZE 的块以 O(1) 的代价插入对应级别链表的头部，
+ * 并在 binMap 中标记该级别非空；大块仍插入有序索引。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param header 空闲块头部。
+ */
+static void insert_Free_Block(kernel_heap_t *heap, kheap_block_header_t *header)
+{
+    if (header->size >= KHEAP_LARGE_BLOCK_SIZE)
+    {
+        if (ordered_Array_Insert(&heap->index, (void *)header) != OK)
+        {
+            monitor_Print("kheap: free block index is full\n");
+        }
+        return;
+    }
+    uint32 bin = bin_Index(header->size);
+    kheap_free_node_t *node = get_Free_Node(header);
+    node->prev = nullptr;
+    node->next = heap->bins[bin];
+    if (heap->bins[bin] != nullptr)
+    {
+        get_Free_Node(heap->bins[bin])->prev = header;
+    }
+    heap->bins[bin] = header;
+    heap->binMap |= (1 << bin);
+}
+
+/**
+ * @brief 将空闲块从其所在的空闲链表或大空闲块索引中摘除。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param header 空闲块头部。
+ */
+static void remove_Free_Block(kernel_heap_t *heap, kheap_block_header_t *header)
+{
+    if (header->size >= KHEAP_LARGE_BLOCK_SIZE)
+    {
+        // 相同大小的块只能通过地址区分，二分定位到相等区间后按指针精确删除
+        ordered_Array_Remove_Exact(&heap->index, (void *)header);
+        return;
+    }
+    uint32 bin = bin_Index(header->size);
+    kheap_free_node_t *node = get_Free_Node(header);
+    if (node->prev != nullptr)
+    {
+        get_Free_Node(node->prev)->next = node->next;
+    }
+    else
+    {
+        heap->bins[bin] = node->next;
+    }
+    if (node->next != nullptr)
+    {
+        get_Free_Node(node->next)->prev = node->prev;
+    }
+    if (heap->bins[bin] == nullptr)
+    {
+        heap->binMap &= ~(1 << bin);
+    }
+}
+
+/**
+ * @brief 一次性将多个空闲块加入空闲链表或大空闲块索引。
  *
- * 该函数会遍历内核堆实例中的所有堆块，查找满足指定大小需求的空闲堆块。
- * 根据是否需要页对齐，采用不同的查找逻辑。若找到合适的堆块，
- * 则返回该堆块在索引数组中的位置，并通过 allocPosition 指针返回分配位置；
- * 若未找到，返回 -1。
+ * 大块先收集起来，再通过 ordered_Array_Insert_Bulk 一次归并到索引中。
  *
  * @param heap 指向内核堆实例的指针。
+ * @param headers 空闲块头部数组。
+ * @param count 空闲块数量，不超过 KHEAP_BULK_MAX。
+ */
+static void insert_Free_Blocks(kernel_heap_t *heap, kheap_block_header_t **headers, uint32 count)
+{
+    void *largeBlocks[KHEAP_BULK_MAX];
+    uint32 largeNum = 0;
+    for (uint32 i = 0; i < count; i++)
+    {
+        if (headers[i]->size >= KHEAP_LARGE_BLOCK_SIZE)
+        {
+            largeBlocks[largeNum++] = (void *)headers[i];
+        }
+        else
+        {
+            insert_Free_Block(heap, headers[i]);
+        }
+    }
+    if (largeNum > 0 && ordered_Array_Insert_Bulk(&heap->index, largeBlocks, largeNum) != OK)
+    {
+        monitor_Print("kheap: free block index is full\n");
+    }
+}
+
+/**
+ * @brief 扩大一个已在空闲链表或索引中的空闲块。
+ *
+ * 原本就在大空闲块索引中的块扩大后仍是大块，直接在索引中原地调整位置，
+ * 避免先删除再插入带来的两次整体搬移。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param header 空闲块头部。
+ * @param size 扩大后的数据区大小。
+ */
+static void grow_Free_Block(kernel_heap_t *heap, kheap_block_header_t *header, uint32 size)
+{
+    if (header->size >= KHEAP_LARGE_BLOCK_SIZE)
+    {
+        uint32 index = ordered_Array_Find(&heap->index, (void *)header);
+        make_Block((uint32)header, size, IS_FREE);
+        ordered_Array_Reposition(&heap->index, index);
+        return;
+    }
+    // 小块扩大后可能属于另一个级别，需要重新挂链
+    remove_Free_Block(heap, header);
+    make_Block((uint32)header, size, IS_FREE);
+    insert_Free_Block(heap, header);
+}
+
+/**
+ * @brief 在大空闲块中查找可以满足页对齐分配的位置。
+ *
+ * @param header 候选空闲块头部。
  * @param size 所需分配的内存大小。
- * @param pageAligned 是否需要页对齐，true 表示需要，false 表示不需要。
  * @param allocPosition 用于存储分配位置的指针。
- * @return int32 找到的空闲堆块在索引数组中的位置，若未找到则返回 -1。
+ * @return bool 找到合适的页对齐位置返回 true。
  */
-static int32 find_Free_Block(kernel_heap_t *heap, uint32 size, bool pageAligned, uint32* allocPosition)
+static bool find_Page_Aligned_Position(kheap_block_header_t *header, uint32 size, uint32 *allocPosition)
 {
-    // 遍历内核堆实例的索引数组
-    for (int i = 0; i < heap->index.size; i++)
+    // 计算当前堆块数据部分的起始地址和结束地址
+    uint32 startAddress = (uint32)header + HEADER_SIZE;
+    uint32 endAddress = startAddress + header->size;
+    // 计算从当前堆块数据起始地址开始的下一个页对齐地址
+    uint32 nextPageAligned = align_Page(startAddress);
+    while (nextPageAligned + size <= endAddress)
     {
-        // 从索引数组中获取当前堆块的头部指针
-        kheap_block_header_t *header = (kheap_block_header_t *)ordered_Array_Get(&heap->index, i);
-        // 计算当前堆块数据部分的起始地址，即头部之后的位置
-        uint32 startAddress = (uint32)header + HEADER_SIZE;
+        // 数据区恰好页对齐，或者前面剩余的空间足够分割出一个新的空闲块
+        if (nextPageAligned == startAddress ||
+            nextPageAligned - startAddress >= BLOCK_META_SIZE + KHEAP_MIN_BLOCK_SIZE)
+        {
+            *allocPosition = nextPageAligned;
+            return true;
+        }
+        // 移动到下一个页对齐地址
+        nextPageAligned += PAGE_SIZE;
+    }
+    return false;
+}
 
-        // 如果需要页对齐
-        if (pageAligned)
+/**
+ * @brief 在一级空闲链表中选出能满足需求的最小块。
+ *
+ * 小于一页的级别只检查表头，保持 O(1)；不小于一页的级别中块的大小相差较大，
+ * 检查前 KHEAP_BIN_SCAN_MAX 个块做有限的最佳匹配，减少大块被拆分造成的碎片。
+ *
+ * @return kheap_block_header_t* 找到的空闲堆块头部，未找到时返回 nullptr。
+ */
+static kheap_block_header_t* bin_Best_Fit(kernel_heap_t *heap, uint32 bin, uint32 size)
+{
+    kheap_block_header_t *best = nullptr;
+    kheap_block_header_t *header = heap->bins[bin];
+    uint32 scan = (bin >= bin_Index(PAGE_SIZE)) ? KHEAP_BIN_SCAN_MAX : 1;
+    for (uint32 i = 0; header != nullptr && i < scan; i++)
+    {
+        if (header->size >= size && (best == nullptr || header->size < best->size))
         {
-            // 计算当前堆块数据部分的结束地址
-            uint32 endAddress = startAddress + header->size;
-            // 计算从当前堆块数据起始地址开始的下一个页对齐地址
-            uint32 nextPageAligned = align_Page(startAddress);
+            best = header;
+        }
+        header = get_Free_Node(header)->next;
+    }
+    return best;
+}
 
-            // 检查下一个页对齐地址加上所需内存大小是否在当前堆块范围内
-            while (nextPageAligned + size <= endAddress)
+/**
+ * @brief 在分级空闲链表中查找可以满足页对齐分配的块。
+ *
+ * 从 size 所在的级别开始，通过 binMap 只访问非空的链表，每一级最多检查
+ * KHEAP_BIN_SCAN_MAX 个块，避免长链表退化为线性扫描。
+ *
+ * @return kheap_block_header_t* 找到的空闲堆块头部，未找到时返回 nullptr。
+ */
+static kheap_block_header_t* find_Page_Aligned_In_Bins(kernel_heap_t *heap, uint32 size, uint32* allocPosition)
+{
+    uint32 binMap = heap->binMap & ~((1 << bin_Index(size)) - 1);
+    int32 bin;
+    while ((bin = bit_Scan_Forward(binMap)) >= 0)
+    {
+        kheap_block_header_t *header = heap->bins[bin];
+        for (uint32 i = 0; header != nullptr && i < KHEAP_BIN_SCAN_MAX; i++)
+        {
+            if (header->size >= size && find_Page_Aligned_Position(header, size, allocPosition))
             {
-                // 检查页对齐地址与堆块数据起始地址之间的空闲空间是否足够分割出一个新的元数据块
-                if (nextPageAligned - startAddress > BLOCK_META_SIZE)
-                {
-                    // 若满足条件，将页对齐地址作为分配位置
-                    *allocPosition = nextPageAligned;
-                    // 返回当前堆块在索引数组中的位置
-                    return i;
-                }
-                // 移动到下一个页对齐地址
-                nextPageAligned += PAGE_SIZE;
+                return header;
             }
+            header = get_Free_Node(header)->next;
         }
-        // 如果不需要页对齐，且当前堆块的大小满足所需内存大小
-        else if (header->size >= size)
+        binMap &= ~(1 << bin);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 查找满足条件的空闲堆块。
+ *
+ * 非页对齐的分配先在同级链表中查找，再通过 binMap 和 bsf 指令
+ * 直接定位到第一个非空的更高级别链表，其中任意一个块都能满足需求，每级最多检查常数个块。
+ * 页对齐的分配在各级链表中有限地查找。链表中没有合适的块时，再在大空闲块索引中二分查找。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param size 所需分配的内存大小。
+ * @param pageAligned 是否需要页对齐，true 表示需要，false 表示不需要。
+ * @param allocPosition 用于存储分配位置的指针。
+ * @return kheap_block_header_t* 找到的空闲堆块头部，若未找到则返回 nullptr。
+ */
+static kheap_block_header_t* find_Free_Block(kernel_heap_t *heap, uint32 size, bool pageAligned, uint32* allocPosition)
+{
+    if (!pageAligned && size < KHEAP_LARGE_BLOCK_SIZE)
+    {
+        uint32 bin = bin_Index(size);
+        // 同级链表中的块不一定都满足需求，更高级别链表中的任意块都满足需求
+        kheap_block_header_t *header = bin_Best_Fit(heap, bin, size);
+        if (header == nullptr)
+        {
+            int32 higherBin = bit_Scan_Forward(heap->binMap & ~((2 << bin) - 1));
+            header = (higherBin >= 0) ? bin_Best_Fit(heap, higherBin, size) : nullptr;
+        }
+        if (header != nullptr)
         {
-            // 将当前堆块数据起始地址作为分配位置
-            *allocPosition = startAddress;
-            // 返回当前堆块在索引数组中的位置
-            return i;
+            *allocPosition = (uint32)header + HEADER_SIZE;
+            return header;
         }
     }
-    // 未找到满足条件的空闲堆块，返回 -1
-    return -1;
+    if (pageAligned && size < KHEAP_LARGE_BLOCK_SIZE)
+    {
+        kheap_block_header_t *header = find_Page_Aligned_In_Bins(heap, size, allocPosition);
+        if (header != nullptr)
+        {
+            return header;
+        }
+    }
+    // 索引按大小升序排列，二分查找第一个不小于 size 的块即为最佳匹配
+    kheap_block_header_t key;
+    key.size = size;
+    for (uint32 i = ordered_Array_Lower_Bound(&heap->index, (void *)&key); i < heap->index.size; i++)
+    {
+        kheap_block_header_t *header = (kheap_block_header_t *)ordered_Array_Get(&heap->index, i);
+        if (!pageAligned)
+        {
+            *allocPosition = (uint32)header + HEADER_SIZE;
+            return header;
+        }
+        if (find_Page_Aligned_Position(header, size, allocPosition))
+        {
+            return header;
+        }
+    }
+    // 未找到满足条件的空闲堆块
+    return nullptr;
 }
 
+/**
+ * @brief 扩展内核堆的结束地址，并为扩展的区域建立映射。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param size 至少需要扩展的大小。
+ * @return uint32 实际扩展的大小（页对齐），超出堆的最大地址时返回 0。
+ */
 static uint32 kheap_Expand(kernel_heap_t *heap, uint32 size)
 {
     uint32 expandSize = align_Page(size);
@@ -168,15 +424,54 @@ static uint32 kheap_Expand(kernel_heap_t *heap, uint32 size)
     {
         return 0;
     }
+    // 一次性为新扩展的区域建立映射，避免之后逐页触发缺页异常，完整的 4MB 对齐区间使用大页
+    map_Pages(heap->endAddress, expandSize / PAGE_SIZE, KHEAP_PAGE_FLAGS | PAGE_LARGE);
+    heap->endAddress = newEndAddress;
     heap->size += expandSize;
+    kheapStats.expands++;
     return expandSize;
 }
 
+/**
+ * @brief 收缩内核堆，将尾部空闲块后面的页归还给伙伴系统。
+ *
+ * 只有尾部空闲块超过 KHEAP_TRIM_THRESHOLD 时才收缩，收缩后保留 KHEAP_TRIM_KEEP 的空闲空间，
+ * 且堆不会小于初始大小。新的结束地址落在大页中时向上对齐到大页边界，避免拆分大页。
+ *
+ * @param heap 指向内核堆实例的指针。
+ * @param header 刚合并完成的空闲块，不是堆的最后一个块时直接返回。
+ */
+static void kheap_Contract(kernel_heap_t *heap, kheap_block_header_t *header)
+{
+    if ((uint32)header + BLOCK_META_SIZE + header->size != heap->endAddress || header->size < KHEAP_TRIM_THRESHOLD)
+    {
+        return;
+    }
+    uint32 newEndAddress = align_Page((uint32)header + BLOCK_META_SIZE + KHEAP_TRIM_KEEP);
+    newEndAddress = max(newEndAddress, heap->startAddress + KHEAP_MIN_SIZE);
+    if (page_Is_Large(newEndAddress))
+    {
+        newEndAddress = (newEndAddress + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+    }
+    if (newEndAddress >= heap->endAddress)
+    {
+        return;
+    }
+    uint32 shrinkSize = heap->endAddress - newEndAddress;
+    remove_Free_Block(heap, header);
+    make_Block((uint32)header, newEndAddress - (uint32)header - BLOCK_META_SIZE, IS_FREE);
+    insert_Free_Block(heap, header);
+    unmap_Pages(newEndAddress, shrinkSize / PAGE_SIZE, true);
+    heap->endAddress = newEndAddress;
+    heap->size -= shrinkSize;
+    kheapStats.contracts++;
+}
+
 /**
  * @brief 创建一个内核堆实例。
  *
  * 此函数用于初始化一个内核堆，设置堆的索引、起始地址、结束地址、当前大小和最大大小，
- * 并创建一个初始的堆块，将其插入到有序数组索引中。
+ * 并创建一个初始的堆块，将其插入到空闲块索引中。
  *
  * @param startAddress 内核堆的起始地址。
  * @param endAddress 内核堆的结束地址。
@@ -187,10 +482,15 @@ static kernel_heap_t kernel_Heap_Create(uint32 startAddress, uint32 endAddress,
 {
     // 定义一个内核堆结构体变量
     kernel_heap_t heap;
-    ordered_array_return_t rtn = 0;
-    // 创建一个有序数组作为堆的索引，用于管理堆块
-    // 起始地址为传入的 startAddress，数组元素数量为 KHEAP_INDEX_NUM，比较函数为 standard_Compare
+    // 创建一个有序数组作为大空闲块的索引
+    // 起始地址为传入的 startAddress，数组元素数量为 KHEAP_INDEX_NUM，比较函数为 kheap_Block_Compare
     heap.index = ordered_Array_Create((void *)startAddress, KHEAP_INDEX_NUM, &kheap_Block_Compare);
+    // 清空所有小空闲块链表
+    for (uint32 i = 0; i < KHEAP_BIN_NUM; i++)
+    {
+        heap.bins[i] = nullptr;
+    }
+    heap.binMap = 0;
     // 更新起始地址，跳过索引占用的内存空间
     startAddress += (sizeof(void*) * KHEAP_INDEX_NUM);
     // 设置堆的起始地址
@@ -202,13 +502,9 @@ static kernel_heap_t kernel_Heap_Create(uint32 startAddress, uint32 endAddress,
     // 设置堆允许的最大大小
     heap.maxSize = maxSize;
     // 在堆的起始地址创建一个新的堆块，数据部分大小为堆当前大小减去元数据大小，标记为未使用
-    make_Block(startAddress, endAddress - startAddress - BLOCK_META_SIZE, IS_FREE);
-    // 将新创建的堆块头部地址插入到堆的有序数组索引中
-    rtn = ordered_Array_Insert(&heap.index, (void *)startAddress);
-    if (rtn != 0)
-    {
-        monitor_Print("ordered_Array_Insert failed\n");
-    }
+    kheap_block_header_t *header = make_Block(startAddress, endAddress - startAddress - BLOCK_META_SIZE, IS_FREE);
+    // 将新创建的堆块加入空闲块索引
+    insert_Free_Block(&heap, header);
     // 返回初始化后的内核堆实例
     return heap;
 }
@@ -224,51 +520,65 @@ static kernel_heap_t kernel_Heap_Create(uint32 startAddress, uint32 endAddress,
  * @param heap 指向内核堆实例的指针。
  * @param size 所需分配的内存大小。
  * @param pageAligned 是否需要页对齐，true 表示需要，false 表示不需要。
- * @return void* 指向分配的内存块的指针，若分配失败可能返回 NULL（递归调用失败时）。
+ * @return void* 指向分配的内存块的指针，堆无法继续扩展时返回 nullptr。
  */
 static void* alloc(kernel_heap_t *heap, uint32 size, bool pageAligned)
 {
+    // 空闲块的数据区需要容纳链表指针，分配大小不能小于最小块大小
+    if (size < KHEAP_MIN_BLOCK_SIZE)
+    {
+        size = KHEAP_MIN_BLOCK_SIZE;
+    }
     // 用于存储分配的内存块的起始地址
     uint32 allocPosition = 0;
-    // 调用 find_Free_Block 函数查找满足条件的空闲堆块，返回该堆块在索引数组中的位置
-    int32 index = find_Free_Block(heap, size, pageAligned, &allocPosition);
+    // 查找满足条件的空闲堆块，处理器支持 TSC 时同时统计查找花费的时间
+    uint64 start = kheapTsc ? cpu_Read_Tsc() : 0;
+    kheap_block_header_t *header = find_Free_Block(heap, size, pageAligned, &allocPosition);
+    kheapStats.findCalls++;
+    if (kheapTsc)
+    {
+        uint32 cycles = (uint32)(cpu_Read_Tsc() - start);
+        kheapStats.findCycles += cycles;
+        kheapStats.findMaxCycles = max(kheapStats.findMaxCycles, cycles);
+    }
     // 若未找到满足条件的空闲堆块
-    if (index < 0)
+    if (header == nullptr)
     {
         // 记录堆原来的结束地址
         uint32 oldEndAddress = heap->endAddress;
-        // 调用 kheap_Expand 函数扩展堆的大小，扩展大小包含所需内存和元数据大小
-        uint32 expandSize = kheap_Expand(heap, size + BLOCK_META_SIZE);
+        // 扩展堆的大小，扩展大小包含所需内存和元数据大小，页对齐时额外预留一页用于对齐
+        uint32 expandSize = kheap_Expand(heap, size + BLOCK_META_SIZE + (pageAligned ? PAGE_SIZE : 0));
+        if (expandSize == 0)
+        {
+            monitor_Printf("kheap: can't expand heap for size %x\n", size);
+            return nullptr;
+        }
         // 获取原堆块的尾部指针
         kheap_block_footer_t *oldFooter = (kheap_block_footer_t *)(oldEndAddress - FOOTER_SIZE);
         // 通过尾部指针获取原堆块的头部指针
         kheap_block_header_t *oldHeader = oldFooter->header;
         // 若原堆块是空闲的
-        if (oldHeader->isFree)
+        if (oldHeader->isFree == IS_FREE)
         {
-            // 合并原堆块和新扩展的空间，创建一个新的空闲堆块
-            make_Block((uint32)oldHeader, oldHeader->size + expandSize, IS_FREE);
-            // 从索引数组中移除原堆块的头部地址
-            int32 remove = ordered_Array_Remove(&heap->index, (void *)oldHeader);
-            // 将新的堆块头部地址插入到索引数组中
-            ordered_Array_Insert(&heap->index, (void *)oldHeader);
+            // 合并原堆块和新扩展的空间
+            grow_Free_Block(heap, oldHeader, oldHeader->size + expandSize);
         }
         else
         {
             // 在原堆块结束地址处创建一个新的空闲堆块，其大小为扩展大小减去元数据大小
             kheap_block_header_t *newHeader = make_Block(oldEndAddress, expandSize - BLOCK_META_SIZE, IS_FREE);
-            // 将新创建的堆块头部地址插入到索引数组中
-            ordered_Array_Insert(&heap->index, (void *)newHeader);
-        }   
+            insert_Free_Block(heap, newHeader);
+        }
         // 递归调用 alloc 函数，再次尝试分配内存
         return alloc(heap, size, pageAligned);
     }
-    // 从索引数组中获取找到的空闲堆块的头部指针
-    kheap_block_header_t *header = (kheap_block_header_t *)ordered_Array_Get(&heap->index, index);
     // 获取该堆块的数据部分大小
     uint32 blockSize = header->size;
-    // 从索引数组中移除该堆块的头部地址
-    ordered_Array_Remove_Index(&heap->index, index);
+    // 将该堆块从空闲链表中摘除
+    remove_Free_Block(heap, header);
+    // 分割出来的空闲块，最后一次性插入
+    kheap_block_header_t *cutBlocks[KHEAP_BULK_MAX];
+    uint32 cutNum = 0;
     // 如果需要页对齐
     if (pageAligned)
     {
@@ -280,9 +590,7 @@ static void* alloc(kernel_heap_t *heap, uint32 size, bool pageAligned)
             // 计算需要分割出来的空闲块的大小
             uint32 cutBlockSize = (uint32)allocHeader - (uint32)header;
             // 创建一个新的空闲堆块，其大小为分割出来的大小减去元数据大小
-            make_Block((uint32)header, cutBlockSize - BLOCK_META_SIZE, IS_FREE);
-            // 将新创建的空闲堆块头部地址插入到索引数组中
-            ordered_Array_Insert(&heap->index, (void *)header);
+            cutBlocks[cutNum++] = make_Block((uint32)header, cutBlockSize - BLOCK_META_SIZE, IS_FREE);
             // 更新当前处理的堆块头部指针为分配内存块的头部指针
             header = allocHeader;
             // 原堆块大小减去分割出去的大小
@@ -291,22 +599,21 @@ static void* alloc(kernel_heap_t *heap, uint32 size, bool pageAligned)
     }
     // 计算分配所需内存后剩余的大小
     uint32 remainSize = blockSize - size;
-    // 若剩余大小小于等于元数据大小，不进行分割，将整个堆块分配出去
-    if (remainSize <= BLOCK_META_SIZE)
+    // 若剩余大小不足以构成一个新的空闲块，不进行分割，将整个堆块分配出去
+    if (remainSize < BLOCK_META_SIZE + KHEAP_MIN_BLOCK_SIZE)
     {
         size = blockSize;
         remainSize = 0;
     }
     // 创建一个新的已使用堆块，其大小为所需分配的内存大小
-    kheap_block_header_t *selectedHeader = make_Block((uint32)header, size, NOT_FREE);
+    make_Block((uint32)header, size, NOT_FREE);
     // 若剩余大小大于 0，分割出一个新的空闲堆块
     if (remainSize > 0)
     {
         // 在已分配堆块之后创建一个新的空闲堆块
-        kheap_block_header_t *remainHeader = make_Block((uint32)header + BLOCK_META_SIZE + size, remainSize - BLOCK_META_SIZE, IS_FREE);
-        // 将新创建的空闲堆块头部地址插入到索引数组中
-        ordered_Array_Insert(&heap->index, (void *)remainHeader);
+        cutBlocks[cutNum++] = make_Block((uint32)header + BLOCK_META_SIZE + size, remainSize - BLOCK_META_SIZE, IS_FREE);
     }
+    insert_Free_Blocks(heap, cutBlocks, cutNum);
     // 返回分配的内存块的起始地址
     return (void*)(allocPosition);
 }
@@ -314,14 +621,17 @@ static void* alloc(kernel_heap_t *heap, uint32 size, bool pageAligned)
 /**
  * @brief 释放内核堆中指定地址的内存块。
  *
- * 该函数会将指定地址的内存块标记为空闲状态，并尝试与相邻的空闲内存块合并，
- * 以减少内存碎片。最后将合并后的空闲内存块插入到内核堆的索引数组中。
+ * 该函数会将指定地址的内存块标记为空闲状态，并通过边界标记与相邻的空闲内存块合并，
+ * 以减少内存碎片。后一个相邻块先从其空闲链表中摘除；与前一个块合并时，
+ * 前一个块在所在的链表或索引中原地扩大，否则将合并后的空闲内存块插入到对应的空闲链表中。
+ * 合并后的空闲块位于堆尾部时，尝试收缩堆。
  *
  * @param heap 指向内核堆实例的指针。
  * @param freedAddress 指向需要释放的内存块起始地址的指针。
  */
 static void free(void* heap, void* freedAddress)
 {
+    kernel_heap_t *kernelHeap = (kernel_heap_t *)heap;
     // 若释放地址为空指针，直接返回，不进行任何操作
     if (freedAddress == nullptr)
     {
@@ -329,47 +639,439 @@ static void free(void* heap, void* freedAddress)
     }
     // 通过释放地址计算该内存块的头部地址，并转换为堆块头部指针
     kheap_block_header_t *header = (kheap_block_header_t *)((uint32)freedAddress - HEADER_SIZE);
+    if (header->magic != KHEAP_MAGIC || header->isFree)
+    {
+        monitor_Printf("kfree: invalid address %x\n", freedAddress);
+        return;
+    }
     // 通过释放地址和内存块大小计算该内存块的尾部地址，并转换为堆块尾部指针
     kheap_block_footer_t *footer = (kheap_block_footer_t *)((uint32)freedAddress + header->size);
     // 将该内存块标记为空闲状态
     header->isFree = IS_FREE;
-    // 初始化新的堆块头部指针，指向当前释放的内存块头部
-    kheap_block_header_t *newHeader = header;
     // 计算下一个内存块的头部地址，并转换为堆块头部指针
     kheap_block_header_t *nextHeader = (kheap_block_header_t *)((uint32)footer + FOOTER_SIZE);
-    // 检查下一个内存块的魔术数字是否正确，并且该内存块是否为空闲状态
-    if (nextHeader->magic == KHEAP_MAGIC && nextHeader->isFree) 
+    // 检查下一个内存块是否在堆内、魔术数字是否正确，并且该内存块是否为空闲状态
+    if ((uint32)nextHeader < kernelHeap->endAddress && nextHeader->magic == KHEAP_MAGIC && nextHeader->isFree == IS_FREE)
     {
-        // 若条件满足，合并当前内存块和下一个内存块，创建一个新的空闲堆块
+        // 从空闲链表中摘除下一个内存块
+        remove_Free_Block(kernelHeap, nextHeader);
+        // 合并当前内存块和下一个内存块，创建一个新的空闲堆块
         make_Block((uint32)header, header->size + BLOCK_META_SIZE + nextHeader->size, IS_FREE);
-        // 从内核堆的索引数组中移除下一个内存块的头部地址
-        int32 index = ordered_Array_Remove(&((kernel_heap_t *)heap)->index, (void *)nextHeader);
     }
     // 计算前一个内存块的尾部地址，并转换为堆块尾部指针
     kheap_block_footer_t *prevFooter = (kheap_block_footer_t *)((uint32)header - FOOTER_SIZE);
-    // 检查前一个内存块的魔术数字是否正确，并且该内存块是否为空闲状态
-    if (prevFooter->magic == KHEAP_MAGIC && prevFooter->header->isFree)
+    // 检查前一个内存块是否在堆内、魔术数字是否正确，并且该内存块是否为空闲状态
+    if ((uint32)header > kernelHeap->startAddress && prevFooter->magic == KHEAP_MAGIC && prevFooter->header->isFree == IS_FREE)
     {
         // 获取前一个内存块的头部指针
         kheap_block_header_t *prevHeader = prevFooter->header;
-        // 合并前一个内存块和当前内存块，创建一个新的空闲堆块
-        make_Block((uint32)prevHeader, prevHeader->size + BLOCK_META_SIZE + header->size, IS_FREE);
-        // 从内核堆的索引数组中移除当前内存块的头部地址
-        int32 index = ordered_Array_Remove(&((kernel_heap_t *)heap)->index, (void *)header);
-        // 更新当前处理的堆块头部指针为前一个内存块的头部指针
-        header = prevHeader;
-        // 更新新的堆块头部指针为合并后的头部指针
-        newHeader = header;
+        // 将当前内存块并入前一个内存块，前一个块在空闲链表或索引中原地更新
+        grow_Free_Block(kernelHeap, prevHeader, prevHeader->size + BLOCK_META_SIZE + header->size);
+        kheap_Contract(kernelHeap, prevHeader);
+        return;
     }
-    // 将合并后的空闲堆块头部地址插入到内核堆的索引数组中
-    ordered_Array_Insert(&((kernel_heap_t *)heap)->index, (void *)newHeader);
+    // 将合并后的空闲堆块插入到对应的空闲链表中
+    insert_Free_Block(kernelHeap, header);
+    kheap_Contract(kernelHeap, header);
 }
 
 
+static kmag_cpu_cache_t* kmag_This_Cpu(uint32 class)
+{
+    return &kmagCpus[0][class];
+}
+
+/**
+ * @brief 计算分配请求所属的 magazine 级别，向上取整到 2 的幂。
+ */
+static uint32 kmag_Alloc_Class(uint32 size)
+{
+    if (size <= (1 << KMAG_MIN_SHIFT))
+    {
+        return 0;
+    }
+    return (uint32)bit_Scan_Reverse(size - 1) + 1 - KMAG_MIN_SHIFT;
+}
+
+/**
+ * @brief 计算释放的块所属的 magazine 级别，向下取整到 2 的幂，保证块能满足该级别的任何请求。
+ */
+static uint32 kmag_Free_Class(uint32 size)
+{
+    return (uint32)bit_Scan_Reverse(size) - KMAG_MIN_SHIFT;
+}
+
+static kmag_magazine_t* kmag_Depot_Get(uint32 class, bool full)
+{
+    kmag_depot_t *depot = &kmagDepots[class];
+    yieldlock_Lock(&depot->lock);
+    kmag_magazine_t **list = full ? &depot->full : &depot->empty;
+    kmag_magazine_t *magazine = *list;
+    if (magazine != nullptr)
+    {
+        *list = magazine->next;
+        if (full)
+        {
+            depot->fullNum--;
+        }
+        else
+        {
+            depot->emptyNum--;
+        }
+    }
+    yieldlock_Unlock(&depot->lock);
+    return magazine;
+}
+
+/**
+ * @brief 将 magazine 放回仓库。
+ *
+ * 仓库中的非空 magazine 已达上限时，先把其中的块归还给堆；空 magazine 已达上限时归还给 slab 缓存。
+ *
+ * @param class magazine 的级别。
+ * @param magazine 要放回的 magazine。
+ */
+static void kmag_Depot_Put(uint32 class, kmag_magazine_t *magazine)
+{
+    kmag_depot_t *depot = &kmagDepots[class];
+    yieldlock_Lock(&depot->lock);
+    if (magazine->rounds > 0 && depot->fullNum < KMAG_DEPOT_MAX)
+    {
+        magazine->next = depot->full;
+        depot->full = magazine;
+        depot->fullNum++;
+        yieldlock_Unlock(&depot->lock);
+        return;
+    }
+    yieldlock_Unlock(&depot->lock);
+    if (magazine->rounds > 0)
+    {
+        yieldlock_Lock(&kheapLock);
+        for (uint32 i = 0; i < magazine->rounds; i++)
+        {
+            ((kheap_block_header_t *)((uint32)magazine->objects[i] - HEADER_SIZE))->isFree = NOT_FREE;
+            free(&kheap, magazine->objects[i]);
+        }
+        yieldlock_Unlock(&kheapLock);
+        magazine->rounds = 0;
+    }
+    yieldlock_Lock(&depot->lock);
+    if (depot->emptyNum < KMAG_DEPOT_MAX)
+    {
+        magazine->next = depot->empty;
+        depot->empty = magazine;
+        depot->emptyNum++;
+        magazine = nullptr;
+    }
+    yieldlock_Unlock(&depot->lock);
+    if (magazine != nullptr)
+    {
+        kmem_Cache_Free(kmagCache, magazine);
+    }
+}
+
+/**
+ * @brief 从本 CPU 的 magazine 中分配一个块。
+ *
+ * 当前 magazine 为空时与上一个交换；两个都为空时从仓库取一个非空的 magazine，
+ * 换下的 magazine 放回仓库。访问本 CPU 的 magazine 时只关中断，不获取任何锁。
+ *
+ * @param class 分配的级别。
+ * @return void* 分配的块，本 CPU 和仓库中都没有该级别的块时返回 nullptr。
+ */
+static void* kmag_Alloc(uint32 class)
+{
+    void *object = nullptr;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    kmag_cpu_cache_t *cpu = kmag_This_Cpu(class);
+    if (cpu->loaded->rounds == 0 && cpu->previous->rounds > 0)
+    {
+        kmag_magazine_t *temp = cpu->loaded;
+        cpu->loaded = cpu->previous;
+        cpu->previous = temp;
+    }
+    if (cpu->loaded->rounds > 0)
+    {
+        object = cpu->loaded->objects[--cpu->loaded->rounds];
+    }
+    set_Eflags(eflags);
+    if (object != nullptr)
+    {
+        return object;
+    }
+    // 仓库有锁，在开中断的状态下交换，换入时重新检查本 CPU 的状态
+    kmag_magazine_t *magazine = kmag_Depot_Get(class, true);
+    if (magazine == nullptr)
+    {
+        return nullptr;
+    }
+    eflags = get_Eflags();
+    disable_Interrupt();
+    cpu = kmag_This_Cpu(class);
+    if (cpu->loaded->rounds == 0)
+    {
+        kmag_magazine_t *temp = cpu->previous;
+        cpu->previous = cpu->loaded;
+        cpu->loaded = magazine;
+        magazine = temp;
+    }
+    object = cpu->loaded->objects[--cpu->loaded->rounds];
+    set_Eflags(eflags);
+    kmag_Depot_Put(class, magazine);
+    return object;
+}
+
+/**
+ * @brief 将一个块放入本 CPU 的 magazine。
+ *
+ * 当前 magazine 已满时与上一个交换；两个都满时从仓库取一个空的 magazine，
+ * 仓库中也没有时新建一个，换下的满 magazine 放回仓库。
+ *
+ * @param class 块的级别。
+ * @param object 要释放的块。
+ * @return bool 无法获取空 magazine 时返回 false，调用者应直接归还给堆。
+ */
+static bool kmag_Free(uint32 class, void *object)
+{
+    bool cached = false;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    kmag_cpu_cache_t *cpu = kmag_This_Cpu(class);
+    if (cpu->loaded->rounds == KMAG_ROUNDS && cpu->previous->rounds < KMAG_ROUNDS)
+    {
+        kmag_magazine_t *temp = cpu->loaded;
+        cpu->loaded = cpu->previous;
+        cpu->previous = temp;
+    }
+    if (cpu->loaded->rounds < KMAG_ROUNDS)
+    {
+        cpu->loaded->objects[cpu->loaded->rounds++] = object;
+        cached = true;
+    }
+    set_Eflags(eflags);
+    if (cached)
+    {
+        return true;
+    }
+    kmag_magazine_t *magazine = kmag_Depot_Get(class, false);
+    if (magazine == nullptr)
+    {
+        magazine = (kmag_magazine_t *)kmem_Cache_Alloc(kmagCache);
+        if (magazine == nullptr)
+        {
+            return false;
+        }
+        magazine->rounds = 0;
+    }
+    eflags = get_Eflags();
+    disable_Interrupt();
+    cpu = kmag_This_Cpu(class);
+    if (cpu->loaded->rounds == KMAG_ROUNDS)
+    {
+        kmag_magazine_t *temp = cpu->previous;
+        cpu->previous = cpu->loaded;
+        cpu->loaded = magazine;
+        magazine = temp;
+    }
+    cpu->loaded->objects[cpu->loaded->rounds++] = object;
+    set_Eflags(eflags);
+    kmag_Depot_Put(class, magazine);
+    return true;
+}
+
+/**
+ * @brief 初始化 magazine 层，为每个 CPU 的每个级别准备两个空 magazine。
+ *
+ * magazine 本身从 slab 缓存中分配，不经过 kmalloc。
+ */
+static void kmag_Init(void)
+{
+    kmagCache = kmem_Cache_Create("kmag_magazine_t", sizeof(kmag_magazine_t), nullptr);
+    if (kmagCache == nullptr)
+    {
+        return;
+    }
+    for (uint32 class = 0; class < KMAG_CLASS_NUM; class++)
+    {
+        yieldlock_Init(&kmagDepots[class].lock);
+        for (uint32 cpu = 0; cpu < KMAG_CPU_NUM; cpu++)
+        {
+            kmagCpus[cpu][class].loaded = (kmag_magazine_t *)kmem_Cache_Alloc(kmagCache);
+            kmagCpus[cpu][class].previous = (kmag_magazine_t *)kmem_Cache_Alloc(kmagCache);
+            if (kmagCpus[cpu][class].loaded == nullptr || kmagCpus[cpu][class].previous == nullptr)
+            {
+                return;
+            }
+            kmagCpus[cpu][class].loaded->rounds = 0;
+            kmagCpus[cpu][class].previous->rounds = 0;
+        }
+    }
+    kmagReady = true;
+}
+
+/**
+ * @brief 记录调用者取得或归还的一个堆块，更新存活块的数量和大小直方图。
+ *
+ * magazine 的快速路径不获取堆锁，计数器只在关中断时修改。
+ *
+ * @param address 块的数据区地址。
+ * @param alloc true 表示分配，false 表示释放。
+ */
+static void kheap_Stats_Account(void* address, bool alloc)
+{
+    uint32 size = ((kheap_block_header_t *)((uint32)address - HEADER_SIZE))->size;
+    int32 bucket = bit_Scan_Reverse(size) - KHEAP_HIST_MIN_SHIFT;
+    bucket = bucket < 0 ? 0 : min(bucket, KHEAP_HIST_NUM - 1);
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (alloc)
+    {
+        kheapStats.allocs++;
+        kheapStats.liveBlocks++;
+        kheapStats.liveBytes += size;
+        kheapStats.histogram[bucket]++;
+    }
+    else
+    {
+        kheapStats.frees++;
+        kheapStats.liveBlocks--;
+        kheapStats.liveBytes -= size;
+        kheapStats.histogram[bucket]--;
+    }
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 统计所有 magazine 中缓存的块数量。
+ */
+static uint32 kmag_Cached_Blocks(void)
+{
+    if (!kmagReady)
+    {
+        return 0;
+    }
+    uint32 blocks = 0;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    for (uint32 cpu = 0; cpu < KMAG_CPU_NUM; cpu++)
+    {
+        for (uint32 class = 0; class < KMAG_CLASS_NUM; class++)
+        {
+            blocks += kmagCpus[cpu][class].loaded->rounds + kmagCpus[cpu][class].previous->rounds;
+        }
+    }
+    set_Eflags(eflags);
+    for (uint32 class = 0; class < KMAG_CLASS_NUM; class++)
+    {
+        yieldlock_Lock(&kmagDepots[class].lock);
+        for (kmag_magazine_t *magazine = kmagDepots[class].full; magazine != nullptr; magazine = magazine->next)
+        {
+            blocks += magazine->rounds;
+        }
+        yieldlock_Unlock(&kmagDepots[class].lock);
+    }
+    return blocks;
+}
+
+/**
+ * @brief 计算 part / total 的千分比，两者同时右移直到乘法不会溢出，避免 64 位除法。
+ */
+static uint32 kheap_Permille(uint32 part, uint32 total)
+{
+    while (total > 0x400000)
+    {
+        part >>= 1;
+        total >>= 1;
+    }
+    return total == 0 ? 0 : part * 1000 / total;
+}
+
+/**
+ * @brief 获取内核堆统计信息的快照。
+ *
+ * 持有堆锁遍历堆中的所有块，得到空闲内存的总量、空闲块数量和最大空闲块，
+ * 耗时与堆中块的数量成正比，只用于诊断。
+ *
+ * @param stats 保存快照的结构体。
+ */
+void kheap_Get_Stats(kheap_stats_t *stats)
+{
+    uint32 cachedBlocks = kmag_Cached_Blocks();
+    yieldlock_Lock(&kheapLock);
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    *stats = kheapStats;
+    set_Eflags(eflags);
+    stats->heapSize = kheap.size;
+    stats->indexSize = kheap.index.size;
+    stats->freeBytes = 0;
+    stats->freeBlocks = 0;
+    stats->largestFree = 0;
+    uint32 address = kheap.startAddress;
+    while (address < kheap.endAddress)
+    {
+        kheap_block_header_t *header = (kheap_block_header_t *)address;
+        if (header->magic != KHEAP_MAGIC)
+        {
+            monitor_Printf("kheap: corrupted block at %x\n", address);
+            break;
+        }
+        if (header->isFree == IS_FREE)
+        {
+            stats->freeBytes += header->size;
+            stats->freeBlocks++;
+            stats->largestFree = max(stats->largestFree, header->size);
+        }
+        address += header->size + BLOCK_META_SIZE;
+    }
+    yieldlock_Unlock(&kheapLock);
+    stats->cachedBlocks = cachedBlocks;
+    // 没有空闲空间时不存在碎片
+    stats->fragmentation = stats->freeBytes == 0 ? 0 : 1000 - kheap_Permille(stats->largestFree, stats->freeBytes);
+}
+
+void kheap_Stats_Dump(void)
+{
+    kheap_stats_t stats;
+    kheap_Get_Stats(&stats);
+    // 平均周期数需要 64 位除法，两者同时右移到 32 位以内再计算
+    uint64 findCycles = stats.findCycles;
+    uint32 findCalls = stats.findCalls;
+    while ((findCycles >> 32) != 0)
+    {
+        findCycles >>= 1;
+        findCalls >>= 1;
+    }
+    monitor_Printf("kheap: size %d KB, free %d KB in %d blocks, largest %d KB, fragmentation %d/1000\n",
+        stats.heapSize / 1024, stats.freeBytes / 1024, stats.freeBlocks,
+        stats.largestFree / 1024, stats.fragmentation);
+    monitor_Printf("kheap: live %d blocks %d KB, cached %d, index %d, expands %d, contracts %d\n",
+        stats.liveBlocks, stats.liveBytes / 1024, stats.cachedBlocks, stats.indexSize,
+        stats.expands, stats.contracts);
+    monitor_Printf("kheap: allocs %d, frees %d, find %d calls, avg %d cycles, max %d cycles\n",
+        stats.allocs, stats.frees, stats.findCalls,
+        findCalls == 0 ? 0 : (uint32)findCycles / findCalls, stats.findMaxCycles);
+    monitor_Printf("kheap: live size histogram\n");
+    for (uint32 i = 0; i < KHEAP_HIST_NUM; i++)
+    {
+        monitor_Printf("  %s%d: %d\n", i == KHEAP_HIST_NUM - 1 ? ">=" : "<",
+            1 << (i + KHEAP_HIST_MIN_SHIFT + (i == KHEAP_HIST_NUM - 1 ? 0 : 1)), stats.histogram[i]);
+    }
+}
+
 void kheap_Init(void)
 {
     yieldlock_Init(&kheapLock);
+    kheapTsc = cpu_Has_Feature(CPUID_FEATURE_TSC);
+    // 堆的第一个 4MB 区间包含索引和初始堆，总是被频繁访问，优先用一个大页映射，
+    // 失败时仍按 4KB 页在缺页时按需映射
+    map_Large_Page(KHEAP_START, -1, KHEAP_PAGE_FLAGS);
     kheap = kernel_Heap_Create(KHEAP_START, KHEAP_START + KHEAP_MIN_SIZE, KHEAP_MAX);
+    kmag_Init();
+    // 常用对象的缓存在启动时一次性创建，使用时再创建会在抢占下重复创建
+    doubly_Linked_List_Cache_Init();
+    hash_Table_Cache_Init();
 }
 
 void* kmalloc(uint32 size, bool pageAligned)
@@ -378,9 +1080,32 @@ void* kmalloc(uint32 size, bool pageAligned)
     {
         return nullptr;
     }
+    // 大块分配在 vmalloc 区间中按页映射，总是页对齐
+    if (size >= KHEAP_VMALLOC_THRESHOLD)
+    {
+        return vmalloc(size);
+    }
+    // 小块优先从本 CPU 的 magazine 中分配，不获取堆锁
+    if (kmagReady && !pageAligned && size <= KMAG_MAX_SIZE)
+    {
+        uint32 class = kmag_Alloc_Class(size);
+        void* ptr = kmag_Alloc(class);
+        if (ptr != nullptr)
+        {
+            ((kheap_block_header_t *)((uint32)ptr - HEADER_SIZE))->isFree = NOT_FREE;
+            kheap_Stats_Account(ptr, true);
+            return ptr;
+        }
+        // 按级别的大小分配，块释放后可以放入同一级别的 magazine
+        size = 1 << (class + KMAG_MIN_SHIFT);
+    }
     yieldlock_Lock(&kheapLock);
     void* ptr =  alloc(&kheap, size, pageAligned);
     yieldlock_Unlock(&kheapLock);
+    if (ptr != nullptr)
+    {
+        kheap_Stats_Account(ptr, true);
+    }
     return ptr;
 }
 
@@ -390,6 +1115,35 @@ void kfree(void* address)
     {
         return;
     }
+    // slab 对象归还给其所属的缓存
+    if (kmem_Is_Slab_Object(address))
+    {
+        kmem_Free_Object(address);
+        return;
+    }
+    if (vmalloc_Contains((uint32)address))
+    {
+        vfree(address);
+        return;
+    }
+    // 与 free 相同的头部检查，已经空闲或已在 magazine 中的块不能再次放入 magazine
+    kheap_block_header_t *header = (kheap_block_header_t *)((uint32)address - HEADER_SIZE);
+    if (header->magic != KHEAP_MAGIC || header->isFree != NOT_FREE)
+    {
+        monitor_Printf("kfree: invalid address %x\n", address);
+        return;
+    }
+    kheap_Stats_Account(address, false);
+    // 小块放入本 CPU 的 magazine，块在堆中仍处于已分配状态，不获取堆锁
+    if (kmagReady && header->size >= (1 << KMAG_MIN_SHIFT) && header->size < (KMAG_MAX_SIZE << 1))
+    {
+        header->isFree = IS_CACHED;
+        if (kmag_Free(kmag_Free_Class(min(header->size, KMAG_MAX_SIZE)), address))
+        {
+            return;
+        }
+        header->isFree = NOT_FREE;
+    }
     yieldlock_Lock(&kheapLock);
     free(&kheap, address);
     yieldlock_Unlock(&kheapLock);
@@ -409,4 +1163,45 @@ void kheap_Test(void)
     monitor_Printf("*p2: %d\n", *p2);
     kfree(p1);
     kfree(p2);
+    // 大块释放后堆尾部的空闲空间超过阈值，堆应收缩回接近原来的大小
+    uint32 oldSize = kheap.size;
+    void *blocks[1024];
+    for (uint32 i = 0; i < 1024; i++)
+    {
+        blocks[i] = kmalloc(KHEAP_VMALLOC_THRESHOLD / 2, NOT_PAGE_ALIGNED);
+    }
+    monitor_Printf("heap size: %x -> %x\n", oldSize, kheap.size);
+    for (uint32 i = 0; i < 1024; i++)
+    {
+        kfree(blocks[i]);
+    }
+    monitor_Printf("heap size after trim: %x\n", kheap.size);
+    // 大块由 vmalloc 分配，不占用堆
+    void *p3 = kmalloc(8 * 1024 * 1024, NOT_PAGE_ALIGNED);
+    ASSERT(vmalloc_Contains((uint32)p3));
+    kfree(p3);
+    ASSERT(kheap.size <= max(oldSize, KHEAP_MIN_SIZE) + LARGE_PAGE_SIZE);
+    // 小块释放后进入本 CPU 的 magazine，同一级别的下一次分配直接取回
+    void *p4 = kmalloc(24, NOT_PAGE_ALIGNED);
+    kfree(p4);
+    void *p5 = kmalloc(30, NOT_PAGE_ALIGNED);
+    ASSERT(p5 == p4);
+    void *small[KMAG_ROUNDS * 3];
+    for (uint32 i = 0; i < KMAG_ROUNDS * 3; i++)
+    {
+        small[i] = kmalloc(100, NOT_PAGE_ALIGNED);
+    }
+    // 释放超过两个 magazine 容量的块，满的 magazine 交换到仓库
+    for (uint32 i = 0; i < KMAG_ROUNDS * 3; i++)
+    {
+        kfree(small[i]);
+    }
+    ASSERT(kmagDepots[kmag_Alloc_Class(100)].fullNum > 0);
+    kfree(p5);
+    // 测试中分配的块都已释放，magazine 中缓存的块不计入存活的分配
+    kheap_stats_t stats;
+    kheap_Get_Stats(&stats);
+    ASSERT(stats.cachedBlocks > 0);
+    ASSERT(stats.largestFree <= stats.freeBytes && stats.fragmentation <= 1000);
+    kheap_Stats_Dump();
 }
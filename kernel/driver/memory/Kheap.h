@@ -46,14 +46,61 @@
 
 #define IS_FREE   1
 #define NOT_FREE  0
+// 块已被释放但缓存在 magazine 中，对堆来说仍是已分配的块，不参与合并
+#define IS_CACHED 2
 
 #define KHEAP_START          0xC0C00000
 #define KHEAP_MIN_SIZE       0x300000
 #define KHEAP_MAX            0xE0000000
 
 #define KHEAP_INDEX_NUM      0x20000
+
+// 堆页面的映射标志，用户态线程目前仍会访问堆上的数据，保留用户位
+#define KHEAP_PAGE_FLAGS     (PAGE_RW | PAGE_USER)
 #define KHEAP_MAGIC          0x123060AB
 
+// 分级空闲链表：第 i 级保存数据区大小在 [2^(i+3), 2^(i+4)) 范围内的空闲块，
+// 不小于 KHEAP_LARGE_BLOCK_SIZE 的空闲块仍按大小有序地保存在 index 中。
+// 链表一直覆盖到 KHEAP_VMALLOC_THRESHOLD，堆中的分配都小于该值，index 中的任意块都能满足
+// 非页对齐的分配，index 只保存合并出的少量大块，插入和删除时的搬移不再随小块数量增长
+#define KHEAP_BIN_MIN_SHIFT      3
+#define KHEAP_BIN_NUM            11
+#define KHEAP_LARGE_BLOCK_SIZE   (1 << (KHEAP_BIN_MIN_SHIFT + KHEAP_BIN_NUM))
+#define KHEAP_MIN_BLOCK_SIZE     (sizeof(kheap_free_node_t))
+
+// 不小于一页的级别和页对齐分配在每一级链表中最多检查的块数量，不满足时再查找 index 或扩展堆
+#define KHEAP_BIN_SCAN_MAX       8
+
+// 一次分配最多分割出的空闲块数量（页对齐前的剩余部分和分配后的剩余部分）
+#define KHEAP_BULK_MAX           2
+
+// 堆尾部的空闲块超过 KHEAP_TRIM_THRESHOLD 时收缩堆，收缩后仍保留 KHEAP_TRIM_KEEP 的空闲空间，
+// 两者之差作为滞后区间，避免在阈值附近反复地扩展和收缩
+#define KHEAP_TRIM_THRESHOLD     (1024 * 1024)
+#define KHEAP_TRIM_KEEP          (256 * 1024)
+
+// 不小于 KHEAP_VMALLOC_THRESHOLD 的分配交给 vmalloc，避免大块在堆中造成碎片
+#define KHEAP_VMALLOC_THRESHOLD  (4 * PAGE_SIZE)
+
+// kmalloc 前面的 magazine 层：不超过 KMAG_MAX_SIZE 的分配按 2 的幂分为 KMAG_CLASS_NUM 个级别，
+// 每个 CPU 对每个级别持有当前和上一个两个 magazine，分配和释放只在本 CPU 的 magazine 上进行，
+// 不获取堆锁；两个 magazine 都空或都满时，才与全局仓库整体交换一个 magazine。
+#define KMAG_MIN_SHIFT           4
+#define KMAG_CLASS_NUM           6
+#define KMAG_MAX_SIZE            (1 << (KMAG_MIN_SHIFT + KMAG_CLASS_NUM - 1))
+#define KMAG_ROUNDS              15
+// 仓库中每个级别最多保留的非空和空 magazine 数量，多出的块归还给堆
+#define KMAG_DEPOT_MAX           8
+// 目前只有一个 CPU，每个调度器对应一组 magazine
+#define KMAG_CPU_NUM             1
+
+// 已分配块的大小直方图：第 i 项统计数据区大小在 [2^(i+4), 2^(i+5)) 的块，
+// 第一项同时包含更小的块，最后一项同时包含更大的块
+#define KHEAP_HIST_MIN_SHIFT     4
+#define KHEAP_HIST_NUM           10
+// 改为 1 时启动完成后打印堆的统计信息
+#define KHEAP_STATS_ON_BOOT      0
+
 struct kheap_block_header
 {
     uint32 magic;
@@ -69,20 +116,85 @@ struct kheap_block_footer
 } __attribute__((packed));
 typedef struct kheap_block_footer kheap_block_footer_t;
 
+/**
+ * @struct kheap_free_node
+ * @brief 空闲块数据区开头保存的链表指针，用于把同一级别的空闲块串成双向链表。
+ */
+struct kheap_free_node
+{
+    kheap_block_header_t *prev;
+    kheap_block_header_t *next;
+} __attribute__((packed));
+typedef struct kheap_free_node kheap_free_node_t;
+
+
+/**
+ * @struct kmag_magazine
+ * @brief 保存若干个同一级别的空闲块，整体在 CPU 和仓库之间交换。
+ */
+struct kmag_magazine
+{
+    struct kmag_magazine *next;     /**< 仓库链表。 */
+    uint32 rounds;                  /**< 当前保存的块数量。 */
+    void *objects[KMAG_ROUNDS];
+};
+typedef struct kmag_magazine kmag_magazine_t;
+
+/**
+ * @struct kmag_cpu_cache
+ * @brief 一个 CPU 在某个级别上的 magazine，只在关中断时访问。
+ */
+struct kmag_cpu_cache
+{
+    kmag_magazine_t *loaded;        /**< 当前使用的 magazine。 */
+    kmag_magazine_t *previous;      /**< 上一个 magazine，当前的空或满时先与之交换，避免在边界上反复访问仓库。 */
+};
+typedef struct kmag_cpu_cache kmag_cpu_cache_t;
 
 typedef struct kernel_heap
 {
-    ordered_array_t index;
+    ordered_array_t index;                      /**< 大空闲块索引，按大小升序排列。 */
+    kheap_block_header_t *bins[KHEAP_BIN_NUM];  /**< 各级小空闲块链表的表头。 */
+    uint32 binMap;                              /**< 第 i 位为 1 表示 bins[i] 非空。 */
     uint32 startAddress;
     uint32 endAddress;
     uint32 maxSize;
     uint32 size;
 } kernel_heap_t;
 
+/**
+ * @struct kheap_stats
+ * @brief 内核堆的统计信息，用于根据实际负载调整分配器的参数。
+ *
+ * 计数器在分配、释放和扩展的路径上累加；空闲块相关的字段在获取快照时遍历整个堆得到。
+ * 位于 magazine 中的块对堆来说仍是已分配的，单独统计，不计入存活的分配。
+ */
+typedef struct kheap_stats
+{
+    uint32 heapSize;                /**< 堆当前的大小。 */
+    uint32 freeBytes;               /**< 空闲块数据区的总大小。 */
+    uint32 freeBlocks;
+    uint32 largestFree;             /**< 最大空闲块的数据区大小。 */
+    uint32 fragmentation;           /**< 碎片化指数 1 - largestFree / freeBytes，以千分之一为单位，没有空闲空间时为 0。 */
+    uint32 indexSize;               /**< 大空闲块索引的长度。 */
+    uint32 cachedBlocks;            /**< magazine 中缓存的块数量。 */
+    uint32 liveBlocks;              /**< 调用者持有的块数量。 */
+    uint32 liveBytes;               /**< 调用者持有的块数据区的总大小。 */
+    uint32 histogram[KHEAP_HIST_NUM];   /**< 调用者持有的块按大小的分布。 */
+    uint32 allocs;                  /**< 累计从堆或 magazine 分配的次数，不含 vmalloc。 */
+    uint32 frees;
+    uint32 expands;                 /**< 堆扩展的次数。 */
+    uint32 contracts;               /**< 堆收缩的次数。 */
+    uint32 findCalls;               /**< find_Free_Block 的调用次数。 */
+    uint64 findCycles;              /**< find_Free_Block 累计花费的 TSC 周期数，没有 TSC 时为 0。 */
+    uint32 findMaxCycles;           /**< find_Free_Block 单次花费的最大周期数。 */
+} kheap_stats_t;
 
 void kheap_Init(void);
 void* kmalloc(uint32 size, bool pageAligned);
 void kfree(void* address);
+void kheap_Get_Stats(kheap_stats_t *stats);
+void kheap_Stats_Dump(void);
 void kheap_Test(void);
 
 #endif
\ No newline at end of file
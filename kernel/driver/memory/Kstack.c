@@ -0,0 +1,177 @@
+/******************************************************************************
+* @file    Kstack.c
+* @brief   内核栈分配与缓存相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Kstack.h"
+#include "Thread.h"
+#include "Bitmap.h"
+#include "Yieldlock.h"
+#include "Scheduler.h"
+
+#define KSTACK_SLOT_SIZE     (KSTACK_GUARD_SIZE + KERNEL_STACK_SIZE)
+#define KSTACK_SLOT_NUM      ((KSTACK_END - KSTACK_START) / KSTACK_SLOT_SIZE)
+#define KSTACK_PAGES         (KERNEL_STACK_SIZE / PAGE_SIZE)
+
+static uint32 slotBits[(KSTACK_SLOT_NUM + 31) / 32];
+static bitmap_t slotMap;
+static bool slotMapReady = false;
+static uint32 cachedStacks[KSTACK_CACHE_MAX];
+static uint32 cachedNum = 0;
+static yieldlock_t kstackLock;
+static uint32 kstackAllocs = 0;
+static uint32 kstackCacheHits = 0;
+
+static uint32 slot_Stack(uint32 slot)
+{
+    return KSTACK_START + slot * KSTACK_SLOT_SIZE + KSTACK_GUARD_SIZE;
+}
+
+/**
+ * @brief 分配一个内核栈。
+ *
+ * 优先复用缓存中的栈，此时只需从数组中弹出一个地址；缓存为空时
+ * 从内核栈区间中取一个空闲槽位，为保护页之上的整个栈分配物理帧。
+ *
+ * @return uint32 栈的最低地址（保护页之上），栈顶为该地址加 KERNEL_STACK_SIZE，失败时返回 0。
+ */
+uint32 kstack_Alloc(void)
+{
+    uint32 stack = 0;
+    yieldlock_Lock(&kstackLock);
+    if (!slotMapReady)
+    {
+        bitmap_Init(&slotMap, slotBits, KSTACK_SLOT_NUM);
+        slotMapReady = true;
+    }
+    kstackAllocs++;
+    if (cachedNum > 0)
+    {
+        stack = cachedStacks[--cachedNum];
+        kstackCacheHits++;
+    }
+    else
+    {
+        uint32 slot;
+        if (bitmap_Allocate_Next_Free_Bit(&slotMap, &slot))
+        {
+            stack = slot_Stack(slot);
+            if (map_Pages(stack, KSTACK_PAGES, PAGE_RW) != KSTACK_PAGES)
+            {
+                unmap_Pages(stack, KSTACK_PAGES, true);
+                bitmap_Clear_Bit(&slotMap, slot);
+                stack = 0;
+            }
+        }
+    }
+    yieldlock_Unlock(&kstackLock);
+    if (stack == 0)
+    {
+        monitor_Printf("kstack: out of kernel stacks\n");
+    }
+    return stack;
+}
+
+/**
+ * @brief 释放一个内核栈。
+ *
+ * 缓存未满时保留映射并压入缓存，否则解除整个栈的映射、归还物理帧并释放槽位。
+ * 调用者必须保证已经不在该栈上运行。
+ *
+ * @param stack kstack_Alloc 返回的栈地址。
+ */
+void kstack_Free(uint32 stack)
+{
+    if (stack < KSTACK_START || stack >= KSTACK_END || (stack - KSTACK_START) % KSTACK_SLOT_SIZE != KSTACK_GUARD_SIZE)
+    {
+        monitor_Printf("kstack: invalid free %x\n", stack);
+        return;
+    }
+    yieldlock_Lock(&kstackLock);
+    if (cachedNum < KSTACK_CACHE_MAX)
+    {
+        cachedStacks[cachedNum++] = stack;
+    }
+    else
+    {
+        unmap_Pages(stack, KSTACK_PAGES, true);
+        bitmap_Clear_Bit(&slotMap, (stack - KSTACK_START) / KSTACK_SLOT_SIZE);
+    }
+    yieldlock_Unlock(&kstackLock);
+}
+
+bool kstack_Is_Guard(uint32 virtualAddress)
+{
+    return virtualAddress >= KSTACK_START && virtualAddress < KSTACK_END
+        && (virtualAddress - KSTACK_START) % KSTACK_SLOT_SIZE < KSTACK_GUARD_SIZE;
+}
+
+void kstack_Dump(void)
+{
+    monitor_Printf("kstack: allocs %d, cache hits %d, cached %d\n",
+        kstackAllocs, kstackCacheHits, cachedNum);
+}
+
+static uint32 kstack_Recurse(uint32 depth)
+{
+    volatile uint8 frame[512];
+    frame[0] = (uint8)depth;
+    if (depth == 0)
+    {
+        return frame[0];
+    }
+    return kstack_Recurse(depth - 1) + frame[0];
+}
+
+static void kstack_Deep_Thread(void)
+{
+    // 约 20KB 的递归，超过原来 8KB 的栈，仍在保护页之上
+    monitor_Printf("kstack recursion: %d\n", kstack_Recurse(40));
+    kstack_Dump();
+}
+
+void kstack_Test(void)
+{
+    monitor_Printf("kstack_Test\n");
+    uint32 s1 = kstack_Alloc();
+    uint32 s2 = kstack_Alloc();
+    ASSERT(s1 != 0 && s2 != 0 && s1 != s2);
+    ASSERT(kstack_Is_Guard(s1 - 1) && !kstack_Is_Guard(s1));
+    *(uint32*)(s1 + KERNEL_STACK_SIZE - 4) = 100;
+    kstack_Free(s1);
+    // 刚释放的栈位于缓存顶部，会被立即复用，整个栈仍然保持映射
+    uint32 s3 = kstack_Alloc();
+    ASSERT(s3 == s1);
+    ASSERT(*(uint32*)(s3 + KERNEL_STACK_SIZE - 4) == 100);
+    // 保护页之上的最低一页同样已经映射
+    *(uint32*)s3 = 101;
+    ASSERT(*(uint32*)s3 == 101);
+    kstack_Free(s2);
+    kstack_Free(s3);
+    tcb_t* thread = thread_Init(nullptr, "kstackThread", kstack_Deep_Thread, THREAD_DEFAULT_PRIORITY, false);
+    add_Thread_To_Schedule(thread);
+}
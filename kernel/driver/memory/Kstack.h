@@ -0,0 +1,51 @@
+/******************************************************************************
+* @file    Kstack.h
+* @brief   内核栈分配与缓存相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef KSTACK_H
+#define KSTACK_H
+
+#include "Std_Types.h"
+
+// 内核栈所在的虚拟地址区间，每个栈占用一个槽位，槽位的最低一页是不映射的保护页，
+// 栈向下溢出时访问保护页会触发缺页异常，而不是悄悄改写相邻线程的栈。
+// 保护页之上的栈空间在分配时全部提交：内核在出错的栈上压入缺页异常帧，栈页缺失会转为
+// 不可恢复的双重错误，因此栈页不能按需映射，双重错误处理只用来报告保护页上的溢出
+#define KSTACK_START         0xEC000000
+#define KSTACK_END           0xF0000000
+#define KSTACK_GUARD_SIZE    PAGE_SIZE
+
+// 释放的栈最多缓存 KSTACK_CACHE_MAX 个，整个栈保持映射以便直接复用，多余的栈归还物理帧
+#define KSTACK_CACHE_MAX     16
+
+uint32 kstack_Alloc(void);
+void kstack_Free(uint32 stack);
+bool kstack_Is_Guard(uint32 virtualAddress);
+void kstack_Dump(void);
+void kstack_Test(void);
+
+#endif // !KSTACK_H
@@ -28,144 +28,705 @@
 ******************************************************************************/
 
 #include "Page_Table.h"
+#include "Buddy.h"
+#include "Tlb.h"
+#include "Debug.h"
+#include "Kstack.h"
+#include "Vmalloc.h"
+#include "Gdt.h"
+
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
 
 page_directory_t *currentPageDirectory = 0;
 
 static bitmap_t phyFrameMap;
-static uint32 bitArray[PHYSICAL_MEM_SIZE / PAGE_SIZE / 32];
+static e820_map_t *e820Map = (e820_map_t*)E820_MAP_VIRTUAL;
+// 启动时必须保留的物理内存区间：boot 和内核页表、内核映像、内核二进制文件的加载区域和启动栈
+static const uint32 bootReserved[][2] =
+{
+    { 0, BOOT_RESERVED_SIZE },
+    { KERNEL_LOAD_PHYSICAL_ADDR, KERNEL_LOAD_PHYSICAL_ADDR + KERNEL_SIZE_MAX },
+    { KERNEL_BIN_LOAD_PHYSICAL_ADDR, PHYSICAL_MEM_MIN },
+};
 static page_directory_t kernelPageDirectory;
+static page_directory_t *directoryList = nullptr;
 
-static bool copyOnWriteReady = false;
+static bool pseEnabled = false;
+// 全局只读的零页，用户空间的读缺页映射到该帧，第一次写入时才分配私有的帧
+static int32 zeroFrame = -1;
 
+// 预先清零的物理帧池，空闲线程负责填充，缺页处理优先从中取帧
+static uint32 zeroPool[ZERO_POOL_SIZE];
+static zero_pool_stats_t zeroPoolStats;
+
+/**
+ * @brief 移除物理帧的一个映射，帧被写时复制共享时只减少共享计数，最后一个映射移除时才释放。
+ * 零页永远不会被释放。
+ */
 static void free_Physical_Frame(uint32 frameAddress)
 {
-    bitmap_Clear_Bit(&phyFrameMap, frameAddress);
+    if ((int32)frameAddress == zeroFrame)
+    {
+        return;
+    }
+    buddy_Put_Frame(frameAddress);
 }
 
 /**
- * @brief 释放指定虚拟地址对应的页表项。
- * 
- * 该函数用于释放指定虚拟地址对应的页表项（PTE）。如果该页表项存在且 freeFrame 标志为真，
- * 则会释放对应的物理帧。最后将页表项置零，标记为无效。
- * 
- * @param virtualAddress 要释放的页的虚拟地址。
- * @param freeFrame 布尔标志，指示是否释放对应的物理帧。
+ * @brief 为物理帧增加一个共享映射，零页不计数。
  */
+static void share_Physical_Frame(uint32 frameAddress)
+{
+    if ((int32)frameAddress == zeroFrame)
+    {
+        return;
+    }
+    buddy_Get_Frame(frameAddress);
+}
+
+static int32 zero_Pool_Pop(void)
+{
+    int32 frame = -1;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (zeroPoolStats.frames > 0)
+    {
+        frame = (int32)zeroPool[--zeroPoolStats.frames];
+    }
+    set_Eflags(eflags);
+    return frame;
+}
+
 /**
- * @brief 释放指定虚拟地址对应的页表项。
+ * @brief 分配一个物理帧，伙伴系统耗尽时使用预先清零的帧池中的帧。
+ */
+static int32 allocate_Physical_Frame(void)
+{
+    int32 frame = buddy_Alloc_Pages(0);
+    if (frame < 0)
+    {
+        frame = zero_Pool_Pop();
+    }
+    return frame;
+}
+
+/**
+ * @brief 分配一个内容为零的物理帧，优先从预先清零的帧池中取得。
+ *
+ * @param zeroed 返回帧是否已经清零，为 false 时调用者需要自行清零。
+ * @return int32 帧号，内存不足时返回 -1。
+ */
+static int32 allocate_Zeroed_Frame(bool *zeroed)
+{
+    int32 frame = zero_Pool_Pop();
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    if (frame >= 0)
+    {
+        zeroPoolStats.hits++;
+    }
+    else
+    {
+        zeroPoolStats.misses++;
+    }
+    set_Eflags(eflags);
+    *zeroed = frame >= 0;
+    return frame >= 0 ? frame : allocate_Physical_Frame();
+}
+
+/**
+ * @brief 清零一页。
+ *
+ * 支持 SSE2 时使用 movntdq 非临时存储，清零的内容绕过缓存直接写入内存，不会把有用的数据挤出缓存；
+ * 否则使用 rep stosd。线程切换时不保存 XMM 寄存器，因此使用期间关闭中断，
+ * 并保存和恢复用到的 xmm0，不影响被中断的代码。
+ *
+ * @param page 页的虚拟地址，必须页对齐。
+ */
+void page_Zero(void* page)
+{
+    uint8* dst = (uint8*)page;
+    if (!cpu_Sse2_Enabled())
+    {
+        uint32 dwords = PAGE_SIZE / 4;
+        asm volatile("cld; rep stosl" : "+D"(dst), "+c"(dwords) : "a"(0) : "memory");
+        return;
+    }
+    uint8 saved[16];
+    uint8* end = dst + PAGE_SIZE;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    asm volatile(
+        "movdqu %%xmm0, (%1)\n\t"
+        "pxor %%xmm0, %%xmm0\n\t"
+        "1:\n\t"
+        "movntdq %%xmm0, (%0)\n\t"
+        "movntdq %%xmm0, 16(%0)\n\t"
+        "movntdq %%xmm0, 32(%0)\n\t"
+        "movntdq %%xmm0, 48(%0)\n\t"
+        "add $64, %0\n\t"
+        "cmp %2, %0\n\t"
+        "jne 1b\n\t"
+        // 非临时存储是弱有序的，sfence 保证之后的写入和映射修改都在其后可见
+        "sfence\n\t"
+        "movdqu (%1), %%xmm0\n\t"
+        : "+r"(dst) : "r"(saved), "r"(end) : "memory", "cc");
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 复制一页。
+ *
+ * 支持 SSE2 时每次用 movdqa 读入 64 字节，再用 movntdq 非临时存储写出；否则使用 rep movsd。
+ * XMM 寄存器的使用规则与 page_Zero 相同。
+ *
+ * @param dest 目标页的虚拟地址，必须页对齐。
+ * @param src 源页的虚拟地址，必须页对齐。
+ */
+void page_Copy(void* dest, const void* src)
+{
+    uint8* dst = (uint8*)dest;
+    const uint8* source = (const uint8*)src;
+    if (!cpu_Sse2_Enabled())
+    {
+        uint32 dwords = PAGE_SIZE / 4;
+        asm volatile("cld; rep movsl" : "+D"(dst), "+S"(source), "+c"(dwords) : : "memory");
+        return;
+    }
+    uint8 saved[64];
+    uint8* end = dst + PAGE_SIZE;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    asm volatile(
+        "movdqu %%xmm0, (%2)\n\t"
+        "movdqu %%xmm1, 16(%2)\n\t"
+        "movdqu %%xmm2, 32(%2)\n\t"
+        "movdqu %%xmm3, 48(%2)\n\t"
+        "1:\n\t"
+        "movdqa (%1), %%xmm0\n\t"
+        "movdqa 16(%1), %%xmm1\n\t"
+        "movdqa 32(%1), %%xmm2\n\t"
+        "movdqa 48(%1), %%xmm3\n\t"
+        "movntdq %%xmm0, (%0)\n\t"
+        "movntdq %%xmm1, 16(%0)\n\t"
+        "movntdq %%xmm2, 32(%0)\n\t"
+        "movntdq %%xmm3, 48(%0)\n\t"
+        "add $64, %1\n\t"
+        "add $64, %0\n\t"
+        "cmp %3, %0\n\t"
+        "jne 1b\n\t"
+        "sfence\n\t"
+        "movdqu (%2), %%xmm0\n\t"
+        "movdqu 16(%2), %%xmm1\n\t"
+        "movdqu 32(%2), %%xmm2\n\t"
+        "movdqu 48(%2), %%xmm3\n\t"
+        : "+r"(dst), "+r"(source) : "r"(saved), "r"(end) : "memory", "cc");
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 清空指定虚拟地址所在页的内容。
+ *
+ * @param addr 页内的任意虚拟地址，会向下按页对齐。
+ */
+static void clear_Page(uint32 addr)
+{
+    page_Zero((void*)(addr & 0xFFFFF000));
+}
+
+/**
+ * @brief 内核空间的映射在所有地址空间中相同，开启 PGE 后加上全局位。
+ *
+ * @param virtualAddress 映射的虚拟地址。
+ * @return uint32 需要附加到页表项或页目录项上的 PAGE_GLOBAL，用户空间地址返回 0。
+ */
+static uint32 page_Global_Flag(uint32 virtualAddress)
+{
+    return (virtualAddress >= KERNEL_SPACE_START && tlb_Global_Enabled()) ? PAGE_GLOBAL : 0;
+}
+
+/**
+ * @brief 将物理帧映射到一个临时虚拟地址，用于访问不属于当前地址空间的页目录、页表或页。
+ *
+ * 临时映射所在的页表属于内核空间，在所有地址空间中共享。每个临时地址同一时间只能有一个使用者，
+ * 调用者必须在关闭中断的情况下使用，并在使用后调用 unmap_Temp_Page。
+ *
+ * @param tempAddress COPIED_PAGE_DIR_VADDR 或 COPIED_PAGE_TABLE_VADDR（COPIED_PAGE_VADDR）。
+ * @param frame 物理帧号。
+ * @return uint32* 临时地址。
+ */
+static uint32* map_Temp_Page(uint32 tempAddress, uint32 frame)
+{
+    pte_t *tempPte = (pte_t*)PAGE_TABLES_VIRTUAL + (tempAddress >> 12);
+    *(uint32*)tempPte = (frame << 12) | PAGE_PRESENT | PAGE_RW;
+    tlb_Flush_Page(tempAddress);
+    return (uint32*)tempAddress;
+}
+
+static void unmap_Temp_Page(uint32 tempAddress)
+{
+    pte_t *tempPte = (pte_t*)PAGE_TABLES_VIRTUAL + (tempAddress >> 12);
+    *(uint32*)tempPte = 0;
+    tlb_Flush_Page(tempAddress);
+}
+
+/**
+ * @brief 写入当前页目录的一个页目录项。
+ *
+ * 内核空间的页目录项在创建进程页目录时被复制，之后所有页目录的内核部分必须保持一致，
+ * 因此修改内核空间的页目录项时同时写入其他所有页目录。内核页目录项只在大页的建立、
+ * 拆分和释放时才会改变，这种情况很少发生。
+ *
+ * @param pdeIndex 页目录项索引。
+ * @param value 页目录项的值。
+ */
+static void set_Pde(uint32 pdeIndex, uint32 value)
+{
+    *((uint32*)PAGE_DIR_VIRTUAL + pdeIndex) = value;
+    if (pdeIndex < KERNEL_PDE_START)
+    {
+        return;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    for (page_directory_t *pageDirectory = directoryList; pageDirectory != nullptr; pageDirectory = pageDirectory->next)
+    {
+        if (pageDirectory != currentPageDirectory)
+        {
+            uint32 *entries = map_Temp_Page(COPIED_PAGE_DIR_VADDR, pageDirectory->pdePhyAddress >> 12);
+            entries[pdeIndex] = value;
+        }
+    }
+    unmap_Temp_Page(COPIED_PAGE_DIR_VADDR);
+    set_Eflags(eflags);
+}
+
+static void clear_Large_Page(uint32 virtualAddress)
+{
+    for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+    {
+        clear_Page(virtualAddress + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief 将一个 4MB 大页拆分为 1024 个 4KB 页。
+ *
+ * 大页的页目录项指向的不是页表，递归映射窗口中对应的位置映射的是大页本身的内存，
+ * 因此新页表先通过临时映射 COPIED_PAGE_TABLE_VADDR 填写，再替换页目录项。
+ * 拆分后各个 4KB 页仍指向原来的物理帧，伙伴系统中的块同时拆分为 0 阶块，可以单独释放。
+ *
+ * @param pdeIndex 大页所在的页目录项索引。
+ * @return pte_t* 新页表中第一个页表项的指针，内存不足时返回 nullptr。
+ */
+static pte_t* split_Large_Page(uint32 pdeIndex)
+{
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+    int32 tableFrame = allocate_Physical_Frame();
+    if (tableFrame < 0)
+    {
+        monitor_Printf("couldn't alloc frame to split large page on %d\n", pdeIndex);
+        return nullptr;
+    }
+    // 临时映射只有一个，填写期间关闭中断
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    uint32 *table = map_Temp_Page(COPIED_PAGE_TABLE_VADDR, tableFrame);
+    uint32 flags = *(uint32*)pde & PAGE_FLAGS_MASK;
+    buddy_Split_Pages(pde->frame, BUDDY_MAX_ORDER);
+    for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+    {
+        table[i] = ((pde->frame + i) << 12) | PAGE_PRESENT | flags;
+    }
+    unmap_Temp_Page(COPIED_PAGE_TABLE_VADDR);
+    set_Pde(pdeIndex, ((uint32)tableFrame << 12) | PAGE_PRESENT | PAGE_RW | PAGE_USER | page_Global_Flag(pdeIndex << 22));
+    // invlpg 大页中的任意地址即可刷新整个大页，递归映射窗口中的旧映射也需要刷新
+    tlb_Flush_Page(pdeIndex << 22);
+    tlb_Flush_Page(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
+    set_Eflags(eflags);
+    return (pte_t*)(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
+}
+
+/**
+ * @brief 获取页目录项对应的页表，页表不存在时可以按需分配。
+ *
+ * 页表通过递归映射连续地出现在 PAGE_TABLES_VIRTUAL 处，第 pdeIndex 个页表的
+ * 虚拟地址为 PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE。
+ *
+ * @param pdeIndex 页目录项索引。
+ * @param create 页表不存在时是否分配新的页表，页目录项为大页时是否将其拆分。
+ * @return pte_t* 页表中第一个页表项的指针，页表不存在且未分配时返回 nullptr。
+ */
+static pte_t* get_Page_Table(uint32 pdeIndex, bool create)
+{
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+    pte_t *pageTable = (pte_t*)(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
+    if (pde->present && pde->ps)
+    {
+        return create ? split_Large_Page(pdeIndex) : nullptr;
+    }
+    if (pde->present)
+    {
+        return pageTable;
+    }
+    if (!create)
+    {
+        return nullptr;
+    }
+    // 分配一个新的物理帧用于存储页表
+    bool zeroed;
+    int32 frameAddress = allocate_Zeroed_Frame(&zeroed);
+    if (frameAddress < 0)
+    {
+        monitor_Printf("couldn't alloc frame for page table on %d\n", pdeIndex);
+        return nullptr;
+    }
+    // 页目录项对应的访问权限由页表项进一步限制，这里允许读写和用户访问；
+    // 全局位对指向页表的页目录项无效，但会作用于递归映射窗口中该页表的映射
+    set_Pde(pdeIndex, ((uint32)frameAddress << 12) | PAGE_PRESENT | PAGE_RW | PAGE_USER | page_Global_Flag(pdeIndex << 22));
+    // 页表通过递归映射出现在 PAGE_TABLES_VIRTUAL 处，刷新这一页以防残留旧的映射
+    tlb_Flush_Page((uint32)pageTable);
+    // 清空新分配的页表所在的物理页，确保页表初始化为 0
+    if (!zeroed)
+    {
+        clear_Page((uint32)pageTable);
+    }
+    return pageTable;
+}
+
+/**
+ * @brief 释放一个页表项。
  * 
- * 该函数用于释放指定虚拟地址对应的页表项（PTE）。如果该页表项存在且 freeFrame 标志为真，
- * 则会释放对应的物理帧。最后将页表项置零，标记为无效，并重新加载页目录使更改生效。
+ * 如果该页表项存在且 freeFrame 标志为真，则会释放对应的物理帧。
+ * 最后将页表项置零，标记为无效，并刷新该页的 TLB 项使更改生效。
  * 
- * @param virtualAddress 要释放的页的虚拟地址。
+ * @param pte 要释放的页表项。
+ * @param virtualAddress 页表项对应的虚拟地址。
  * @param freeFrame 布尔标志，指示是否释放对应的物理帧。
+ * @param batch TLB 刷新批量，为 nullptr 时立即使用 invlpg 刷新该页。
+ * @return bool 页表项原本存在时返回 true。
  */
-static void release_Page(uint32 virtualAddress, bool freeFrame)
+static bool release_Pte(pte_t *pte, uint32 virtualAddress, bool freeFrame, tlb_batch_t *batch)
 {
-    // 通过右移 12 位计算虚拟地址对应的页表项（PTE）索引
-    // 在 32 位 x86 分页机制中，虚拟地址的中间 10 位用于索引页表项
-    uint32 pteIndex = virtualAddress >> 12;
-    // 计算页表项的虚拟地址，将页目录的虚拟基地址加上 PTE 索引，转换为 pte_t 类型指针
-    pte_t* pte = (pte_t*)(PAGE_DIR_VIRTUAL + pteIndex);
     // 检查该页表项是否存在于内存中
     if (!pte->present)
     {
-        // 若页表项不存在，则直接返回
-        return;
+        return false;
     }
-    // 获取该页表项对应的物理帧地址
-    uint32 frame = pte->frame;
     // 检查是否需要释放对应的物理帧
     if (freeFrame)
     {
-        // 调用 free_Physical_Frame 函数释放对应的物理帧
-        free_Physical_Frame(frame);
+        free_Physical_Frame(pte->frame);
     }
-    // 将页表项对应的内存位置零，将该页表项标记为无效
+    // 将页表项置零，将该页表项标记为无效
     *((uint32*)pte) = 0;
-    // 重新加载页目录，使页表项的更改生效
-    reload_Page_Directory(currentPageDirectory);
+    // 只刷新这一页的 TLB 项，范围操作时累积到批量中统一刷新
+    if (batch != nullptr)
+    {
+        tlb_Batch_Add(batch, virtualAddress);
+    }
+    else
+    {
+        tlb_Flush_Page(virtualAddress);
+    }
+    return true;
+}
+
+static bool page_Table_Empty(uint32 pdeIndex)
+{
+    uint32 *table = (uint32*)(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
+    for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+    {
+        if (table[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool page_Large_Supported(void)
+{
+    return pseEnabled;
+}
+
+bool page_Is_Large(uint32 virtualAddress)
+{
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + (virtualAddress >> 22);
+    return pde->present && pde->ps;
+}
+
+/**
+ * @brief 用一个 PSE 大页映射 4MB 的虚拟地址区间。
+ *
+ * @param virtualAddress 虚拟地址，必须 4MB 对齐，且对应的页目录项尚未使用或指向一个空页表。
+ * @param frame 大页的首个物理帧号，必须 1024 帧对齐；为负数时从伙伴系统分配一个最大阶的块并清零。
+ * @param flags 页目录项标志，PAGE_RW、PAGE_USER、PAGE_GLOBAL 的组合。
+ * @return bool 未开启 PSE、地址未对齐、区间已被映射或内存不足时返回 false，调用者应回退到 4KB 页。
+ */
+bool map_Large_Page(uint32 virtualAddress, int32 frame, uint32 flags)
+{
+    uint32 pdeIndex = virtualAddress >> 22;
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+    if (!pseEnabled || (virtualAddress & (LARGE_PAGE_SIZE - 1)) != 0 || (pde->present && (pde->ps || !page_Table_Empty(pdeIndex))))
+    {
+        return false;
+    }
+    bool allocated = false;
+    if (frame < 0)
+    {
+        // 伙伴系统最大阶的块恰好是 4MB，且按 4MB 对齐
+        frame = buddy_Alloc_Pages(BUDDY_MAX_ORDER);
+        if (frame < 0)
+        {
+            return false;
+        }
+        allocated = true;
+    }
+    if ((frame & (PAGE_TABLE_ENTRIES - 1)) != 0)
+    {
+        return false;
+    }
+    // 页目录项指向空页表时直接用大页替换。loader 预先分配的页表位于启动保留区，不再使用；
+    // 大页拆分或 get_Page_Table 从伙伴系统分配的页表在替换后归还，否则每次收缩、扩展都会泄漏一帧
+    bool replaced = pde->present;
+    uint32 oldTable = pde->frame;
+    set_Pde(pdeIndex, ((uint32)frame << 12) | PAGE_LARGE | PAGE_PRESENT | (flags & PAGE_FLAGS_MASK) |
+        page_Global_Flag(virtualAddress));
+    // 页目录项原本不存在时无需刷新 TLB，替换空页表时只需刷新递归映射窗口中该页表的映射
+    if (replaced)
+    {
+        tlb_Flush_Page(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
+        if (oldTable >= BOOT_RESERVED_SIZE / PAGE_SIZE)
+        {
+            buddy_Free_Pages(oldTable, 0);
+        }
+    }
+    if (allocated)
+    {
+        clear_Large_Page(virtualAddress);
+    }
+    return true;
 }
 
+/**
+ * @brief 为 [virtualAddress, virtualAddress + pages * PAGE_SIZE) 范围建立映射。
+ *
+ * 每个页目录项只查找（必要时分配）一次页表，然后在页表内连续处理页表项。
+ * 已经存在的映射保持不变，不存在的页分配新的物理帧并清零。
+ * 页表项由不存在变为存在时无需刷新 TLB。
+ * 指定 PAGE_LARGE 时，完整覆盖且尚未使用的 4MB 对齐区间优先用一个大页映射，
+ * 区间未对齐或无法分配 4MB 连续物理内存时回退到 4KB 页。
+ *
+ * @param virtualAddress 起始虚拟地址，会向下按页对齐。
+ * @param pages 页数。
+ * @param flags 页表项标志，PAGE_RW、PAGE_USER、PAGE_GLOBAL、PAGE_LARGE 的组合。
+ * @return uint32 新建立映射的页数，物理内存不足时提前返回已建立的页数。
+ */
+uint32 map_Pages(uint32 virtualAddress, uint32 pages, uint32 flags)
+{
+    uint32 populated = 0;
+    uint32 pteIndexStart = virtualAddress >> 12;
+    uint32 pteIndexEnd = pteIndexStart + pages;
+    uint32 pdeIndex = pteIndexStart >> 10;
+    uint32 pteIndex = pteIndexStart;
+    while (pteIndex < pteIndexEnd)
+    {
+        uint32 tableEnd = min(pteIndexEnd, (pdeIndex + 1) * PAGE_TABLE_ENTRIES);
+        pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+        // 已经由大页映射的区间无需处理
+        if (pde->present && pde->ps)
+        {
+            pteIndex = tableEnd;
+            pdeIndex++;
+            continue;
+        }
+        if ((flags & PAGE_LARGE) && pteIndex == pdeIndex * PAGE_TABLE_ENTRIES &&
+            tableEnd == (pdeIndex + 1) * PAGE_TABLE_ENTRIES && map_Large_Page(pdeIndex << 22, -1, flags))
+        {
+            populated += PAGE_TABLE_ENTRIES;
+            pteIndex = tableEnd;
+            pdeIndex++;
+            continue;
+        }
+        pte_t *pageTable = get_Page_Table(pdeIndex, true);
+        if (pageTable == nullptr)
+        {
+            return populated;
+        }
+        uint32 pteFlags = (flags & PAGE_FLAGS_MASK) | page_Global_Flag(pdeIndex << 22);
+        for (; pteIndex < tableEnd; pteIndex++)
+        {
+            pte_t *pte = pageTable + (pteIndex & 0x3FF);
+            if (pte->present)
+            {
+                continue;
+            }
+            bool zeroed;
+            int32 frame = allocate_Zeroed_Frame(&zeroed);
+            if (frame < 0)
+            {
+                monitor_Printf("couldn't alloc frame for addr %x\n", pteIndex * PAGE_SIZE);
+                return populated;
+            }
+            *(uint32*)pte = ((uint32)frame << 12) | PAGE_PRESENT | pteFlags;
+            if (!zeroed)
+            {
+                clear_Page(pteIndex * PAGE_SIZE);
+            }
+            populated++;
+        }
+        pdeIndex++;
+    }
+    return populated;
+}
 
 /**
  * @brief 释放从指定虚拟地址开始的连续多个页表项。
  * 
- * 该函数用于释放从指定虚拟地址开始的连续多个页表项（PTE）。会遍历涉及的页目录项（PDE），
- * 对每个存在的页目录项，再遍历其中相关的页表项，并调用 release_Page 函数释放这些页表项。
+ * 每个页目录项只检查一次，不存在的页表整体跳过，存在的页表在其内部连续释放页表项。
+ * 完整覆盖的大页直接整体归还给伙伴系统，只覆盖了一部分的大页先拆分为 4KB 页。
+ * 所有页释放完成后统一刷新 TLB，页数较多时退化为一次整体刷新。
  * 
  * @param virtualAddress 起始虚拟地址，释放操作将从该地址所在页开始。
  * @param pages 要释放的连续页的数量。
  * @param freeFrame 布尔标志，指示是否释放对应的物理帧。
+ * @return uint32 实际释放的页数。
  */
-static void release_Pages(uint32 virtualAddress, uint32 pages, bool freeFrame)
+uint32 unmap_Pages(uint32 virtualAddress, uint32 pages, bool freeFrame)
 {
-    // 将虚拟地址按页边界（PAGE_SIZE）对齐，确保操作从页的起始位置开始
-    virtualAddress = (virtualAddress / PAGE_SIZE) * PAGE_SIZE;
-    // 计算起始虚拟地址对应的页表项（PTE）索引
+    uint32 released = 0;
     uint32 pteIndexStart = virtualAddress >> 12;
-    // 计算结束时的页表项索引，即起始索引加上要释放的页数
     uint32 pteIndexEnd = pteIndexStart + pages;
-    // 计算起始页表项对应的页目录项（PDE）索引
-    uint32 pdeIndexStart = pteIndexStart >> 10;
-    // 计算结束时的页目录项索引
-    uint32 pdeIndexEnd = ((pteIndexEnd - 1) >> 10) + 1;
-
-    // 遍历涉及的页目录项
-    for (uint32 pdeIndex = pdeIndexStart; pdeIndex < pdeIndexEnd; pdeIndex++)
-    {
-        // 计算当前页目录项的虚拟地址，并转换为 pde_t 类型指针
-        pde_t *pde = (pde_t*)(PAGE_DIR_VIRTUAL + pdeIndex);
-        // 检查当前页目录项是否存在于内存中
-        if (!pde->present)
+    uint32 pdeIndex = pteIndexStart >> 10;
+    uint32 pteIndex = pteIndexStart;
+    tlb_batch_t batch;
+    tlb_Batch_Init(&batch);
+    while (pteIndex < pteIndexEnd)
+    {
+        uint32 tableEnd = min(pteIndexEnd, (pdeIndex + 1) * PAGE_TABLE_ENTRIES);
+        pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+        bool large = pde->present && pde->ps;
+        if (large && pteIndex == pdeIndex * PAGE_TABLE_ENTRIES && tableEnd == (pdeIndex + 1) * PAGE_TABLE_ENTRIES)
         {
-            // 若不存在，则跳过当前页目录项，继续下一个
+            if (freeFrame)
+            {
+                buddy_Free_Pages(pde->frame, BUDDY_MAX_ORDER);
+            }
+            set_Pde(pdeIndex, 0);
+            tlb_Batch_Add(&batch, pdeIndex << 22);
+            released += PAGE_TABLE_ENTRIES;
+            pteIndex = tableEnd;
+            pdeIndex++;
             continue;
         }
-        // 遍历当前页目录项对应的页表项
-        for (uint32 pteIndex = max(pteIndexStart, pdeIndex * 1024); pteIndex < min(pteIndexEnd, (pdeIndex + 1) * 1024); pteIndex++)
+        pte_t *pageTable = get_Page_Table(pdeIndex, large);
+        // 页表不存在时跳过整个页目录项
+        for (; pageTable != nullptr && pteIndex < tableEnd; pteIndex++)
         {
-            // 调用 release_Page 函数释放当前页表项对应的页
-            release_Page(pteIndex * PAGE_SIZE, freeFrame);
+            if (release_Pte(pageTable + (pteIndex & 0x3FF), pteIndex * PAGE_SIZE, freeFrame, &batch))
+            {
+                released++;
+            }
         }
+        pteIndex = tableEnd;
+        pdeIndex++;
     }
+    tlb_Batch_Flush(&batch);
+    return released;
 }
 
-static int32 allocate_Physical_Frame(void)
+/**
+ * @brief 处理对写时复制页的写入。
+ *
+ * 其他映射仍在共享该帧时，分配新帧并复制内容，当前映射改为指向新帧；
+ * 其他映射都已经复制或释放时，当前映射独占该帧，直接恢复可写即可。
+ * 零页总是被共享，写入时分配新帧并清零，无需复制。
+ *
+ * @param virtualAddress 发生写保护错误的页的虚拟地址。
+ * @return bool 该页是写时复制页且处理成功时返回 true。
+ */
+static bool copy_On_Write(uint32 virtualAddress)
 {
-    uint32 frameAddress = 0;
-    if (!bitmap_Allocate_First_Free_Bit(&phyFrameMap, &frameAddress))
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + (virtualAddress >> 22);
+    if (!pde->present || pde->ps)
+    {
+        return false;
+    }
+    pte_t *pte = (pte_t*)PAGE_TABLES_VIRTUAL + (virtualAddress >> 12);
+    uint32 entry = *(uint32*)pte;
+    if (!(entry & PAGE_PRESENT) || !(entry & PAGE_COW))
     {
-        return -1;
+        return false;
     }
-    return (int32)frameAddress;
+    uint32 oldFrame = entry >> 12;
+    uint32 flags = (entry & PAGE_FLAGS_MASK) | PAGE_RW;
+    if ((int32)oldFrame != zeroFrame && buddy_Frame_Share_Count(oldFrame) == 0)
+    {
+        *(uint32*)pte = (oldFrame << 12) | PAGE_PRESENT | flags;
+    }
+    else
+    {
+        bool zeroed = false;
+        int32 frame = (int32)oldFrame == zeroFrame ? allocate_Zeroed_Frame(&zeroed) : allocate_Physical_Frame();
+        if (frame < 0)
+        {
+            monitor_Printf("couldn't alloc frame to copy on write at %x\n", virtualAddress);
+            return false;
+        }
+        uint32 eflags = get_Eflags();
+        disable_Interrupt();
+        if (!zeroed)
+        {
+            uint32 *copy = map_Temp_Page(COPIED_PAGE_VADDR, frame);
+            if ((int32)oldFrame == zeroFrame)
+            {
+                page_Zero(copy);
+            }
+            else
+            {
+                page_Copy(copy, (void*)virtualAddress);
+            }
+            unmap_Temp_Page(COPIED_PAGE_VADDR);
+        }
+        *(uint32*)pte = ((uint32)frame << 12) | PAGE_PRESENT | flags;
+        set_Eflags(eflags);
+        free_Physical_Frame(oldFrame);
+    }
+    tlb_Flush_Page(virtualAddress);
+    return true;
 }
 
 /**
- * @brief 清空指定物理页的内容。
- * 
- * 该函数将指定物理地址所在页的所有内容清零。首先会将传入的地址按页边界对齐，
- * 然后遍历该页的每个 32 位字，将其值设置为 0。
- * 
- * @param addr 要清空内容的物理页的起始地址。
+ * @brief 将用户空间的一页映射到只读的零页。
+ *
+ * 读取从未写入过的匿名内存时不分配物理帧，页表项标记为只读和 PAGE_COW，
+ * 第一次写入时由 copy_On_Write 分配私有的帧并清零。
+ *
+ * @param virtualAddress 页的虚拟地址。
+ * @return bool 零页不可用或内存不足时返回 false，调用者应直接分配帧。
  */
-static void clear_Page(uint32 addr)
+static bool map_Zero_Page(uint32 virtualAddress)
 {
-    // 将传入的地址按页边界（4KB，即 0x1000）对齐，确保操作的是整个页
-    addr = addr & 0xFFFFF000;
-    // 循环遍历该页的每个 32 位字，PAGE_SIZE 为页的大小，除以 4 得到 32 位字的数量
-    for (int i = 0; i < PAGE_SIZE / 4; i++)
+    if (zeroFrame < 0 || virtualAddress >= KERNEL_SPACE_START)
+    {
+        return false;
+    }
+    pte_t *pageTable = get_Page_Table(virtualAddress >> 22, true);
+    if (pageTable == nullptr)
+    {
+        return false;
+    }
+    pte_t *pte = pageTable + ((virtualAddress >> 12) & 0x3FF);
+    if (!pte->present)
     {
-        // 将当前 32 位字的内存地址转换为 uint32 指针，并将其值设置为 0
-        *(uint32 *)(addr + i * 4) = 0;
+        // 页表项原本不存在，无需刷新 TLB
+        *(uint32*)pte = ((uint32)zeroFrame << 12) | PAGE_PRESENT | PAGE_USER | PAGE_COW;
     }
+    return true;
 }
 
-// static int32 change_Cow_Frame_Refcount(uint32 frameAddress, int32 refCount)
-// {
-//     if (!)
-// }
-
 static void page_Fault_Handler(isr_params_t params)
 {
     uint32 faultAddr;
@@ -175,16 +736,96 @@ static void page_Fault_Handler(isr_params_t params)
     int userMode = params.errCode & 0x4;
     int reserved = params.errCode & 0x8;
     int id = params.errCode & 0x10;
-    map_Page(faultAddr / PAGE_SIZE * PAGE_SIZE, -1);
-    reload_Page_Directory(currentPageDirectory);
+    uint32 pageAddr = faultAddr / PAGE_SIZE * PAGE_SIZE;
+    // 访问内核栈下方的保护页说明栈已经溢出，不能为其建立映射
+    if (kstack_Is_Guard(pageAddr))
+    {
+        monitor_Printf("page fault: kernel stack overflow at %x, eip %x\n", faultAddr, params.eip);
+        PANIC();
+    }
+    // vmalloc 区域在分配时已经全部映射，缺页只能是访问了保护页或已经释放的区域
+    if (!present && vmalloc_Contains(pageAddr))
+    {
+        monitor_Printf("page fault: unmapped vmalloc address %x, eip %x\n", faultAddr, params.eip);
+        PANIC();
+    }
+    if (present)
+    {
+        // 写保护错误，fork 之后共享的页在第一次写入时才复制
+        if (rw && copy_On_Write(pageAddr))
+        {
+            return;
+        }
+        monitor_Printf("page fault: protection violation at %x, eip %x, errCode %x\n",
+            faultAddr, params.eip, params.errCode);
+        PANIC();
+    }
+    // 用户空间的读缺页先映射零页，写入时才真正分配
+    if (!rw && map_Zero_Page(pageAddr))
+    {
+        return;
+    }
+    // 缺页时页表项原本不存在，CPU 不会缓存不存在的页表项，建立映射后无需刷新 TLB
+    map_Page(pageAddr, -1);
+}
+
+/**
+ * @brief 双重错误处理，运行在独立的双重错误任务中。
+ *
+ * 内核栈溢出到保护页时，CPU 向同一个栈压入缺页异常帧会再次缺页，从而转为双重错误，
+ * 此时 CR2 是压栈的地址。双重错误属于中止类异常，被中断的指令不能重新执行，
+ * 因此这里只报告错误（CR2 位于保护页时报告为栈溢出）并停机。
+ *
+ * @param errCode 错误码，双重错误的错误码总为 0。
+ */
+void double_Fault_Handler(uint32 errCode)
+{
+    uint32 faultAddr;
+    asm volatile("mov %%cr2, %0" : "=r"(faultAddr));
+    tss_entry_t *tss = get_Tss();
+    if (kstack_Is_Guard(faultAddr))
+    {
+        monitor_Printf("double fault: kernel stack overflow at %x, eip %x, esp %x\n", faultAddr, tss->eip, tss->esp);
+    }
+    else
+    {
+        monitor_Printf("double fault: cr2 %x, eip %x, esp %x, errCode %x\n", faultAddr, tss->eip, tss->esp, errCode);
+    }
+    PANIC();
+}
+
+/**
+ * @brief 将虚拟地址映射到调用者提供的物理帧，不分配页表也不清零。
+ *
+ * 用于映射不由伙伴系统管理的物理帧，例如 APIC 寄存器和启动时放置的帧描述符。
+ *
+ * @param virtualAddress 虚拟地址，所在的页表必须已经存在。
+ * @param frame 物理帧号。
+ * @param flags 页表项标志，PAGE_RW、PAGE_USER 的组合。
+ * @return bool 页表不存在或该页已经映射时返回 false。
+ */
+bool map_Page_Frame(uint32 virtualAddress, uint32 frame, uint32 flags)
+{
+    pte_t *pageTable = get_Page_Table(virtualAddress >> 22, false);
+    if (pageTable == nullptr)
+    {
+        return false;
+    }
+    pte_t *pte = pageTable + ((virtualAddress >> 12) & 0x3FF);
+    if (pte->present)
+    {
+        return false;
+    }
+    // 页表项原本不存在，无需刷新 TLB
+    *(uint32*)pte = (frame << 12) | PAGE_PRESENT | (flags & PAGE_FLAGS_MASK) | page_Global_Flag(virtualAddress);
+    return true;
 }
 
 /**
  * @brief 将虚拟地址映射到指定物理帧。
  * 
- * 该函数用于将指定的虚拟地址映射到一个物理帧。首先根据虚拟地址计算页目录项（PDE）索引，
- * 检查对应的 PDE 是否存在。若不存在，则分配新的物理帧存储页表，并设置 PDE。
- * 接着计算页表项（PTE）索引，根据传入的物理帧参数设置 PTE。
+ * 该函数用于将指定的虚拟地址映射到一个物理帧。首先根据虚拟地址找到对应的页表，
+ * 页表不存在时分配新的物理帧存储页表。接着根据传入的物理帧参数设置页表项（PTE）。
  * 
  * @param virtualAddress 要映射的虚拟地址。
  * @param frame 要映射到的物理帧地址，若为负数则尝试分配新的物理帧。
@@ -194,41 +835,20 @@ void map_Page(uint32 virtualAddress, int32 frame)
     // 通过右移 22 位计算虚拟地址对应的页目录项（PDE）索引
     // 在 32 位 x86 分页机制中，虚拟地址的高 10 位用于索引页目录项
     uint32 pdeIndex = virtualAddress >> 22;
-    // 将页目录的虚拟基地址转换为 pde_t 类型的指针，再加上 PDE 索引，得到对应的 PDE 指针
-    pde_t *kernelPageDirVirtual = (pde_t*)PAGE_DIR_VIRTUAL;
-    pde_t *pde = kernelPageDirVirtual + pdeIndex;
-
-    // 检查该 PDE 对应的页目录表是否存在于内存中
-    if (!pde->present)
+    pde_t *pde = (pde_t*)PAGE_DIR_VIRTUAL + pdeIndex;
+    // 大页中的地址总是存在的，只有需要映射到指定物理帧时才拆分大页
+    if (pde->present && pde->ps && frame < 0)
     {
-        // 若页目录表不存在，则分配一个新的物理帧用于存储页目录表
-        int32 frameAddress = allocate_Physical_Frame();
-        // 检查物理帧分配是否失败
-        if (frameAddress < 0)
-        {
-            // 打印错误信息，提示无法为指定索引的页目录表分配物理帧
-            monitor_Printf("couldn't alloc frame for page table on %d\n", pdeIndex);
-            return;
-        }
-        // 将分配的物理帧地址赋值给 PDE 的 frame 字段
-        pde->frame = frameAddress;
-        // 将 PDE 的 present 位置为 1，表示对应的页目录表存在于内存中
-        pde->present = 1;
-        // 将 PDE 的读写位置为 1，表示页表可读写
-        pde->rw = 1;
-        // 将 PDE 的未使用位清零
-        pde->unused = 0;
-        // 重新加载页目录，使新的页目录表设置生效
-        reload_Page_Directory(currentPageDirectory);
-        // 清空新分配的页表所在的物理页，确保页表初始化为 0
-        clear_Page(PAGE_TABLES_VIRTUAL + pdeIndex * PAGE_SIZE);
-    }
-    // 通过右移 12 位并与 0x3FF 进行按位与运算，计算虚拟地址对应的页表项（PTE）索引
-    // 在 32 位 x86 分页机制中，虚拟地址的中间 10 位用于索引页表项
-    uint32 pteIndex = virtualAddress >> 12;
-    // 计算页表项的虚拟地址，将页表的虚拟基地址加上 PDE 索引对应的偏移，转换为 pte_t 类型指针
-    pte_t* kernelPageTablesVirtual = (pte_t*)PAGE_TABLES_VIRTUAL;
-    pte_t* pte = kernelPageTablesVirtual + pteIndex;
+        return;
+    }
+    // 获取页表，页表不存在时分配新的页表
+    pte_t *pageTable = get_Page_Table(pdeIndex, true);
+    if (pageTable == nullptr)
+    {
+        return;
+    }
+    // 虚拟地址的中间 10 位用于索引页表项
+    pte_t* pte = pageTable + ((virtualAddress >> 12) & 0x3FF);
     // 若传入的物理帧地址大于 0，则直接使用该物理帧进行映射
     if (frame > 0)
     {
@@ -240,21 +860,24 @@ void map_Page(uint32 virtualAddress, int32 frame)
         pte->rw = 1;
         // 将 PTE 的用户位设置为 1，表示用户模式可以访问该页
         pte->user = 1;
-        // 重新加载页目录，使新的页表项设置生效
-        reload_Page_Directory(currentPageDirectory);
+        pte->global = page_Global_Flag(virtualAddress) ? 1 : 0;
+        // 可能替换了已经存在的映射，刷新这一页的 TLB 项
+        tlb_Flush_Page(virtualAddress);
     }
     else
     {
         // 若 PTE 对应的页不存在于内存中
         if (!pte->present)
         {
-            // 尝试分配一个新的物理帧
-            frame = allocate_Physical_Frame();
+            // 尝试分配一个新的物理帧，优先使用预先清零的帧
+            bool zeroed;
+            frame = allocate_Zeroed_Frame(&zeroed);
             // 检查物理帧分配是否失败
             if (frame < 0)
             {
                 // 打印错误信息，提示无法为指定虚拟地址分配物理帧
                 monitor_Printf("couldn't alloc frame for addr %x\n", virtualAddress);
+                return;
             }
             // 将分配的物理帧地址赋值给 PTE 的 frame 字段
             pte->frame = frame;
@@ -264,10 +887,14 @@ void map_Page(uint32 virtualAddress, int32 frame)
             pte->rw = 1;
             // 将 PTE 的用户位设置为 1，表示用户模式可以访问该页
             pte->user = 1;
-            // 重新加载页目录，使新的页表项设置生效
-            reload_Page_Directory(currentPageDirectory);
+            // 内核空间的页在所有地址空间中相同，标记为全局页
+            pte->global = page_Global_Flag(virtualAddress) ? 1 : 0;
+            // 页表项原本不存在，无需刷新 TLB
             // 清空新分配的物理页，确保页内容初始化为 0
-            clear_Page(virtualAddress);
+            if (!zeroed)
+            {
+                clear_Page(virtualAddress);
+            }
         }
     }
 }
@@ -294,11 +921,426 @@ void enable_Paging(void)
     asm volatile("mov %0, %%cr0":: "r"(cr0));
 }
 
+/**
+ * @brief 切换到指定的页目录。
+ *
+ * 写入 CR3 只刷新非全局页的 TLB 项。开启 PGE 后内核空间的映射都是全局页，
+ * 切换地址空间时保留在 TLB 中，只有用户空间的映射需要重新填充。
+ *
+ * @param pageDirectory 要切换到的页目录。
+ */
 void reload_Page_Directory(page_directory_t *pageDirectory)
 {
-    asm volatile("mov %0, %%cr3" : : "r"(pageDirectory->pdePhyAddress));
+    currentPageDirectory = pageDirectory;
+    updateTssCr3(pageDirectory->pdePhyAddress);
+    asm volatile("mov %0, %%cr3" : : "r"(pageDirectory->pdePhyAddress) : "memory");
 }
 
+/**
+ * @brief 清零一个物理帧并放入预先清零的帧池。
+ *
+ * 由空闲线程在 CPU 没有其他工作时调用。清零通过专用的临时映射 ZEROING_PAGE_VADDR 进行，
+ * 除 page_Zero 使用 SSE2 的短暂区间外不关闭中断，其他线程随时可以抢占。
+ *
+ * @return bool 池未满且成功放入一个帧时返回 true，池已满或内存不足时返回 false。
+ */
+bool page_Zero_Pool_Refill(void)
+{
+    if (zeroPoolStats.frames >= ZERO_POOL_SIZE || buddy_Free_Frames() == 0)
+    {
+        return false;
+    }
+    int32 frame = buddy_Alloc_Pages(0);
+    if (frame < 0)
+    {
+        return false;
+    }
+    page_Zero(map_Temp_Page(ZEROING_PAGE_VADDR, frame));
+    unmap_Temp_Page(ZEROING_PAGE_VADDR);
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    bool pushed = zeroPoolStats.frames < ZERO_POOL_SIZE;
+    if (pushed)
+    {
+        zeroPool[zeroPoolStats.frames++] = frame;
+        zeroPoolStats.refills++;
+    }
+    set_Eflags(eflags);
+    if (!pushed)
+    {
+        buddy_Free_Pages(frame, 0);
+    }
+    return pushed;
+}
+
+void page_Zero_Pool_Get_Stats(zero_pool_stats_t *stats)
+{
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    *stats = zeroPoolStats;
+    set_Eflags(eflags);
+}
+
+void page_Zero_Pool_Dump(void)
+{
+    zero_pool_stats_t stats;
+    page_Zero_Pool_Get_Stats(&stats);
+    monitor_Printf("zero pool: %d/%d frames, hits %d, misses %d, refills %d\n",
+        stats.frames, ZERO_POOL_SIZE, stats.hits, stats.misses, stats.refills);
+}
+
+page_directory_t* page_Kernel_Directory(void)
+{
+    return &kernelPageDirectory;
+}
+
+/**
+ * @brief 创建一个新的页目录。
+ *
+ * 内核空间的页目录项从当前页目录复制，所有页目录共享内核的页表；用户空间为空，
+ * 页目录自身映射到 PAGE_DIR_SELF_INDEX，使该地址空间的页表出现在 PAGE_TABLES_VIRTUAL 处。
+ *
+ * @param pageDirectory 要初始化的页目录。
+ * @return bool 内存不足时返回 false。
+ */
+bool page_Directory_Create(page_directory_t *pageDirectory)
+{
+    int32 frame = allocate_Physical_Frame();
+    if (frame < 0)
+    {
+        return false;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    uint32 *entries = map_Temp_Page(COPIED_PAGE_DIR_VADDR, frame);
+    uint32 *currentEntries = (uint32*)PAGE_DIR_VIRTUAL;
+    for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+    {
+        entries[i] = i < KERNEL_PDE_START ? 0 : currentEntries[i];
+    }
+    // 页表窗口不允许用户态访问
+    entries[PAGE_DIR_SELF_INDEX] = ((uint32)frame << 12) | PAGE_PRESENT | PAGE_RW;
+    unmap_Temp_Page(COPIED_PAGE_DIR_VADDR);
+    pageDirectory->pdePhyAddress = (uint32)frame << 12;
+    pageDirectory->next = directoryList;
+    directoryList = pageDirectory;
+    set_Eflags(eflags);
+    return true;
+}
+
+/**
+ * @brief 将当前地址空间的用户部分以写时复制的方式复制到新页目录中。
+ *
+ * 只复制页表，不复制页：父子双方的页表项指向相同的物理帧，可写的页在双方都被改为只读并
+ * 标记 PAGE_COW，帧的共享计数加一。之后任何一方写入时由页错误处理函数复制该页。
+ * 内核页目录的用户空间只有启动时低端内存的恒等映射，不复制。
+ *
+ * @param pageDirectory 由 page_Directory_Create 创建、用户空间为空的页目录。
+ * @return bool 内存不足时返回 false，已复制的部分由 page_Directory_Destroy 释放。
+ */
+bool page_Directory_Clone(page_directory_t *pageDirectory)
+{
+    if (currentPageDirectory == &kernelPageDirectory)
+    {
+        return true;
+    }
+    bool result = true;
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    for (uint32 pdeIndex = 0; pdeIndex < KERNEL_PDE_START; pdeIndex++)
+    {
+        if (!((pde_t*)PAGE_DIR_VIRTUAL + pdeIndex)->present)
+        {
+            continue;
+        }
+        // 大页先拆分，使每个 4KB 页可以单独复制
+        uint32 *srcTable = (uint32*)get_Page_Table(pdeIndex, true);
+        int32 tableFrame = srcTable != nullptr ? allocate_Physical_Frame() : -1;
+        if (tableFrame < 0)
+        {
+            result = false;
+            break;
+        }
+        uint32 *dstTable = map_Temp_Page(COPIED_PAGE_TABLE_VADDR, tableFrame);
+        for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+        {
+            uint32 entry = srcTable[i];
+            if (entry & PAGE_PRESENT)
+            {
+                if (entry & PAGE_RW)
+                {
+                    entry = (entry & ~PAGE_RW) | PAGE_COW;
+                    srcTable[i] = entry;
+                }
+                share_Physical_Frame(entry >> 12);
+            }
+            dstTable[i] = entry;
+        }
+        uint32 *dstEntries = map_Temp_Page(COPIED_PAGE_DIR_VADDR, pageDirectory->pdePhyAddress >> 12);
+        dstEntries[pdeIndex] = ((uint32)tableFrame << 12) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    }
+    unmap_Temp_Page(COPIED_PAGE_TABLE_VADDR);
+    unmap_Temp_Page(COPIED_PAGE_DIR_VADDR);
+    // 父进程的可写页变为只读，用户空间的映射都不是全局页，重新加载 CR3 即可
+    tlb_Flush_User();
+    set_Eflags(eflags);
+    return result;
+}
+
+/**
+ * @brief 释放页目录的用户空间和页目录本身。
+ *
+ * 用户页通过共享计数释放，仍被其他地址空间共享的帧只减少计数。内核空间的页表由所有页目录共享，不释放。
+ *
+ * @param pageDirectory 要释放的页目录，不能是当前正在使用的页目录。
+ */
+void page_Directory_Destroy(page_directory_t *pageDirectory)
+{
+    if (pageDirectory == currentPageDirectory || pageDirectory == &kernelPageDirectory)
+    {
+        monitor_Printf("page directory %x is in use\n", pageDirectory->pdePhyAddress);
+        return;
+    }
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    for (page_directory_t **link = &directoryList; *link != nullptr; link = &(*link)->next)
+    {
+        if (*link == pageDirectory)
+        {
+            *link = pageDirectory->next;
+            break;
+        }
+    }
+    uint32 *entries = map_Temp_Page(COPIED_PAGE_DIR_VADDR, pageDirectory->pdePhyAddress >> 12);
+    for (uint32 pdeIndex = 0; pdeIndex < KERNEL_PDE_START; pdeIndex++)
+    {
+        uint32 pde = entries[pdeIndex];
+        if (!(pde & PAGE_PRESENT))
+        {
+            continue;
+        }
+        if (pde & PAGE_LARGE)
+        {
+            buddy_Free_Pages(pde >> 12, BUDDY_MAX_ORDER);
+            continue;
+        }
+        uint32 *table = map_Temp_Page(COPIED_PAGE_TABLE_VADDR, pde >> 12);
+        for (uint32 i = 0; i < PAGE_TABLE_ENTRIES; i++)
+        {
+            if (table[i] & PAGE_PRESENT)
+            {
+                free_Physical_Frame(table[i] >> 12);
+            }
+        }
+        free_Physical_Frame(pde >> 12);
+    }
+    unmap_Temp_Page(COPIED_PAGE_TABLE_VADDR);
+    unmap_Temp_Page(COPIED_PAGE_DIR_VADDR);
+    free_Physical_Frame(pageDirectory->pdePhyAddress >> 12);
+    set_Eflags(eflags);
+}
+
+
+/**
+ * @brief 检测 CPU 是否支持 PSE，支持时设置 CR4.PSE 开启 4MB 大页。
+ */
+static void enable_Pse(void)
+{
+    if (!cpu_Has_Feature(CPUID_FEATURE_PSE))
+    {
+        monitor_Printf("PSE not supported, use 4KB pages only\n");
+        return;
+    }
+    cpu_Write_Cr4(cpu_Read_Cr4() | CR4_PSE);
+    pseEnabled = true;
+}
+
+/**
+ * @brief loader 没有得到 E820 内存布局时，按 PHYSICAL_MEM_MIN 构造一段可用内存。
+ */
+static void e820_Fallback(void)
+{
+    if (e820Map->count > 0 && e820Map->count <= E820_MAX_ENTRIES)
+    {
+        return;
+    }
+    monitor_Printf("e820: no memory map from BIOS, assume %d MB\n", PHYSICAL_MEM_MIN >> 20);
+    e820Map->count = 1;
+    e820Map->entries[0].base = 0;
+    e820Map->entries[0].length = PHYSICAL_MEM_MIN;
+    e820Map->entries[0].type = E820_USABLE;
+}
+
+/**
+ * @brief 将 E820 表项裁剪到 4GB 以下并对齐到页，得到帧号区间 [start, end)。
+ *
+ * @param entry E820 表项。
+ * @param inward 为 true 时向内对齐（可用内存只取完整的帧），否则向外对齐（保留区域覆盖所有相关的帧）。
+ */
+static void e820_Frame_Range(e820_entry_t *entry, bool inward, uint32 *start, uint32 *end)
+{
+    uint64 limit = (uint64)1 << 32;
+    uint64 base = entry->base;
+    uint64 top = entry->base + entry->length;
+    base = base < limit ? base : limit;
+    top = top < limit ? top : limit;
+    if (inward)
+    {
+        *start = (uint32)((base + PAGE_SIZE - 1) >> 12);
+        *end = (uint32)(top >> 12);
+    }
+    else
+    {
+        *start = (uint32)(base >> 12);
+        *end = (uint32)((top + PAGE_SIZE - 1) >> 12);
+    }
+    if (*end < *start)
+    {
+        *end = *start;
+    }
+}
+
+/**
+ * @brief 判断帧号区间 [start, end) 是否完全位于某一段可用内存中。
+ */
+static bool e820_Frames_Usable(uint32 start, uint32 end)
+{
+    for (uint32 i = 0; i < e820Map->count; i++)
+    {
+        uint32 first, last;
+        e820_Frame_Range(&e820Map->entries[i], true, &first, &last);
+        if (e820Map->entries[i].type == E820_USABLE && start >= first && end <= last)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 在可用内存中为物理帧位图和帧描述符找一段连续的物理帧，避开启动时保留的区间。
+ *
+ * @param frames 需要的帧数。
+ * @return int32 起始帧号，找不到时返回 -1。
+ */
+static int32 frame_Meta_Place(uint32 frames)
+{
+    for (uint32 i = 0; i < e820Map->count; i++)
+    {
+        if (e820Map->entries[i].type != E820_USABLE)
+        {
+            continue;
+        }
+        uint32 start, end;
+        e820_Frame_Range(&e820Map->entries[i], true, &start, &end);
+        bool moved = true;
+        // 与保留区间重叠时跳到该区间之后重新检查，直到不再移动
+        while (moved && start + frames <= end)
+        {
+            moved = false;
+            for (uint32 j = 0; j < sizeof(bootReserved) / sizeof(bootReserved[0]); j++)
+            {
+                uint32 reservedStart = bootReserved[j][0] / PAGE_SIZE;
+                uint32 reservedEnd = bootReserved[j][1] / PAGE_SIZE;
+                if (start < reservedEnd && start + frames > reservedStart)
+                {
+                    start = reservedEnd;
+                    moved = true;
+                }
+            }
+        }
+        if (start + frames <= end)
+        {
+            return start;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 根据 E820 内存布局建立物理帧位图并初始化伙伴系统。
+ *
+ * 帧数由 4GB 以下最高的可用地址决定，位图和帧描述符按帧数动态分配在一段空闲的物理内存中，
+ * 映射到 FRAME_META_VIRTUAL。位图中先把所有帧标记为已占用，再清除可用内存对应的位，
+ * 最后标记保留区域、启动时占用的内存和元数据本身。
+ */
+static void frame_Map_Init(void)
+{
+    e820_Fallback();
+    uint32 frameNum = 0;
+    uint32 usableFrames = 0;
+    for (uint32 i = 0; i < e820Map->count; i++)
+    {
+        e820_entry_t *entry = &e820Map->entries[i];
+        uint32 start, end;
+        e820_Frame_Range(entry, true, &start, &end);
+        monitor_Printf("e820: %x - %x type %d\n", (uint32)entry->base,
+            (uint32)(entry->base + entry->length), entry->type);
+        if (entry->type == E820_USABLE && end > start)
+        {
+            frameNum = max(frameNum, end);
+            usableFrames += end - start;
+        }
+    }
+    frameNum = max(frameNum, PHYSICAL_MEM_MIN / PAGE_SIZE);
+    // 位图按 32 位的字存储，帧数向上对齐到 32
+    frameNum = (frameNum + 31) & ~31;
+    uint32 bitmapSize = frameNum / 8;
+    uint32 metaSize = (bitmapSize + frameNum * sizeof(page_frame_t) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (metaSize > FRAME_META_MAX_SIZE)
+    {
+        // 帧描述符放不下时只管理前面一部分内存
+        frameNum = (FRAME_META_MAX_SIZE / (sizeof(page_frame_t) + 1)) & ~31;
+        bitmapSize = frameNum / 8;
+        metaSize = (bitmapSize + frameNum * sizeof(page_frame_t) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    }
+    int32 metaFrame = frame_Meta_Place(metaSize / PAGE_SIZE);
+    if (metaFrame < 0)
+    {
+        monitor_Printf("no physical memory for %d KB frame metadata\n", metaSize / 1024);
+        PANIC();
+    }
+    for (uint32 i = 0; i < metaSize / PAGE_SIZE; i++)
+    {
+        map_Page_Frame(FRAME_META_VIRTUAL + i * PAGE_SIZE, metaFrame + i, PAGE_RW);
+    }
+    uint32 *bitArray = (uint32*)FRAME_META_VIRTUAL;
+    page_frame_t *frameTable = (page_frame_t*)(FRAME_META_VIRTUAL + bitmapSize);
+    phyFrameMap = bitmap_Create(bitArray, frameNum);
+    // 必须在 bitmap_Create 之后进行，否则会被清零
+    bitmap_Set_Range(&phyFrameMap, 0, frameNum);
+    for (uint32 i = 0; i < e820Map->count; i++)
+    {
+        uint32 start, end;
+        e820_Frame_Range(&e820Map->entries[i], true, &start, &end);
+        if (e820Map->entries[i].type == E820_USABLE && start < frameNum)
+        {
+            bitmap_Clear_Range(&phyFrameMap, start, min(end, frameNum) - start);
+        }
+    }
+    // 不同类型的表项可能重叠，保留区域优先
+    for (uint32 i = 0; i < e820Map->count; i++)
+    {
+        uint32 start, end;
+        e820_Frame_Range(&e820Map->entries[i], false, &start, &end);
+        if (e820Map->entries[i].type != E820_USABLE && start < frameNum)
+        {
+            bitmap_Set_Range(&phyFrameMap, start, min(end, frameNum) - start);
+        }
+    }
+    // 将前 2MB（1MB boot，1MB 内核页表）、内核、内核栈所在的物理内存标记为已占用，
+    // 内核二进制文件的加载区域同样标记为已使用，稍后通过 unmap_Pages 归还给伙伴系统
+    for (uint32 i = 0; i < sizeof(bootReserved) / sizeof(bootReserved[0]); i++)
+    {
+        bitmap_Set_Range(&phyFrameMap, bootReserved[i][0] / PAGE_SIZE,
+            (bootReserved[i][1] - bootReserved[i][0]) / PAGE_SIZE);
+    }
+    bitmap_Set_Range(&phyFrameMap, metaFrame, metaSize / PAGE_SIZE);
+    monitor_Printf("memory: %d KB usable, %d frames managed, metadata %d KB at %x\n",
+        usableFrames * (PAGE_SIZE / 1024), frameNum, metaSize / 1024, metaFrame * PAGE_SIZE);
+    // 位图此后只用于描述启动时的物理内存占用情况，物理帧的分配和释放都由伙伴系统负责
+    buddy_Init(&phyFrameMap, frameTable);
+}
 
 /**
  * @brief 初始化分页机制。
@@ -308,32 +1350,95 @@ void reload_Page_Directory(page_directory_t *pageDirectory)
  */
 void page_Table_Init(void)
 {
-    // 为什么是 3MB，1MB boot，1MB kernel，1MB Kheap
-    // 计算前 3MB 物理内存对应的位图数组元素数量，将这些元素初始化为全 1
-    // 表示前 3MB 物理内存已被占用
-    for (int i = 0; i < 3 * 1024 * 1024 / PAGE_SIZE / 32; i++)
-    {
-        bitArray[i] = 0xffffffff;
-    }
-    // 创建物理帧位图，使用 bitArray 数组管理物理内存帧
-    // PHYSICAL_MEM_SIZE / PAGE_SIZE 表示物理内存总帧数
-    phyFrameMap = bitmap_Create(bitArray, PHYSICAL_MEM_SIZE / PAGE_SIZE);
-    // 将最后一个物理帧标记为已使用
-    bitmap_Set_Bit(&phyFrameMap, PHYSICAL_MEM_SIZE / PAGE_SIZE - 1);
+    frame_Map_Init();
     // 设置内核页目录的物理地址
     kernelPageDirectory.pdePhyAddress = KERNEL_PAGE_DIR_PHY;
+    kernelPageDirectory.next = nullptr;
+    directoryList = &kernelPageDirectory;
     // 将当前页目录指针指向内核页目录
     currentPageDirectory = &kernelPageDirectory;
     // 释放从 0xFFFFFFFF - KERNEL_BIN_LOAD_SIZE + 1 开始的连续页表项
     // KERNEL_BIN_LOAD_SIZE / PAGE_SIZE 表示要释放的页数
     // true 表示同时释放对应的物理帧
-    release_Pages(0xFFFFFFFF - KERNEL_BIN_LOAD_SIZE + 1, KERNEL_BIN_LOAD_SIZE / PAGE_SIZE, true);
+    // 加载区域不在可用内存中时（例如与 BIOS 保留的区域重叠）只解除映射，不归还物理帧
+    unmap_Pages(0xFFFFFFFF - KERNEL_BIN_LOAD_SIZE + 1, KERNEL_BIN_LOAD_SIZE / PAGE_SIZE,
+        e820_Frames_Usable(KERNEL_BIN_LOAD_PHYSICAL_ADDR / PAGE_SIZE,
+            (KERNEL_BIN_LOAD_PHYSICAL_ADDR + KERNEL_BIN_LOAD_SIZE) / PAGE_SIZE));
+    // 分配并清零全局零页，临时映射位于内核二进制文件的加载区域，必须在其释放之后
+    zeroFrame = allocate_Physical_Frame();
+    if (zeroFrame >= 0)
+    {
+        uint32 eflags = get_Eflags();
+        disable_Interrupt();
+        page_Zero(map_Temp_Page(COPIED_PAGE_VADDR, zeroFrame));
+        unmap_Temp_Page(COPIED_PAGE_VADDR);
+        set_Eflags(eflags);
+    }
+    // 开启 PGE，loader 建立的内核映射已经带有全局位，从此在切换地址空间时保留
+    if (!tlb_Enable_Global())
+    {
+        monitor_Printf("PGE not supported, kernel TLB entries are flushed on CR3 reload\n");
+    }
+    // 开启 PSE，供内核堆等区间使用大页。内核映像保留 loader 建立的 4KB 页：
+    // 用户态线程目前直接执行内核代码，映像必须带用户位，换成大页会把其后的 3MB 物理内存也暴露给用户态
+    enable_Pse();
+    // 开启 CR0.WP，内核态写入只读的用户页时同样触发页错误，写时复制才能覆盖内核代写用户内存的情况
+    cpu_Write_Cr0(cpu_Read_Cr0() | CR0_WP);
     // 注册页错误中断处理函数，页错误中断号为 14
     register_Interrupt_Handler(14, page_Fault_Handler);
 }
 
 
 
+/**
+ * @brief 测量切换页目录后访问内核页的开销，比较关闭和开启 PGE 两种情况。
+ *
+ * 每轮先重新加载 CR3，再读取 pages 个不同的 4KB 内核页。关闭 PGE 时这些页的
+ * TLB 项在每次切换后都会丢失，开启后保留在 TLB 中。被访问的页取自递归映射窗口中
+ * 预分配的内核页表，每个页表占一个独立的 4KB 页且不会被大页覆盖。
+ *
+ * @param pages 每轮访问的页数，不超过预分配的内核页表数量。
+ */
+void page_Switch_Benchmark(uint32 pages)
+{
+    uint32 firstPde = (KERNEL_LOAD_VIRTUAL_ADDR >> 22) + 1;
+    pages = min(pages, PAGE_TABLE_ENTRIES - firstPde);
+    bool pge = tlb_Global_Enabled();
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    for (uint32 pass = 0; pass < 2; pass++)
+    {
+        if (pass == 0)
+        {
+            tlb_Disable_Global();
+        }
+        else if (!tlb_Enable_Global())
+        {
+            break;
+        }
+        uint32 cycles = 0;
+        volatile uint32 sink = 0;
+        for (uint32 round = 0; round < PAGE_BENCHMARK_ROUNDS; round++)
+        {
+            uint64 start = cpu_Read_Tsc();
+            reload_Page_Directory(currentPageDirectory);
+            for (uint32 i = 0; i < pages; i++)
+            {
+                sink += *(volatile uint32*)(PAGE_TABLES_VIRTUAL + (firstPde + i) * PAGE_SIZE);
+            }
+            // 单轮的周期数远小于 2^32，只取低 32 位，避免 64 位除法
+            cycles += (uint32)(cpu_Read_Tsc() - start);
+        }
+        monitor_Printf("switch + touch %d kernel pages, PGE %s: %d cycles/round\n",
+            pages, pass == 0 ? "off" : "on", cycles / PAGE_BENCHMARK_ROUNDS);
+    }
+    if (!pge)
+    {
+        tlb_Disable_Global();
+    }
+    set_Eflags(eflags);
+}
+
 void page_Table_Test(void)
 {
     uint32 i = 0x10000000;
@@ -34,32 +34,100 @@
 #include "Interrupt.h"
 #include "Bitmap.h"
 #include "Math.h"
+#include "Cpu.h"
 
 #define PAGE_SIZE  4096
+// PSE 大页大小，一个页目录项直接映射 4MB，与伙伴系统的最大阶（1024 个帧）相同
+#define LARGE_PAGE_SIZE  (4 * 1024 * 1024)
+#define PAGE_TABLE_ENTRIES  1024
 
 // ********************* virtual memory layout *********************************
 // 0xC0000000 ... 0xC0100000 ... 0xC0400000  boot & reserverd                4MB
 // 0xC0400000 ... 0xC0800000 page tables, 0xC0701000 page directory          4MB
 // 0xC0800000 ... 0xC0900000 kernel load                                     1MB
+// 0xC0C00000 ... 0xE0000000 kernel heap
+// 0xE0000000 ... 0xE4000000 slab pages                                     64MB
+// 0xE4000000 ... 0xEC000000 vmalloc                                       128MB
+// 0xEC000000 ... 0xF0000000 kernel stacks                                  64MB
+// 0xF0400000 ... 0xF1400000 physical frame bitmap & descriptors        <= 16MB
 #define PAGE_DIR_VIRTUAL              0xC0701000
 #define PAGE_TABLES_VIRTUAL           0xC0400000
 #define KERNEL_LOAD_VIRTUAL_ADDR      0xC0800000
-#define KERNEL_LOAD_PHYSICAL_ADDR     0x200000
+// 内核的物理地址与虚拟地址对 4MB 同余
+#define KERNEL_LOAD_PHYSICAL_ADDR     0x400000
 #define KERNEL_SIZE_MAX               (1024 * 1024)
 
 #define COPIED_PAGE_DIR_VADDR         0xFFFFE000
 #define COPIED_PAGE_TABLE_VADDR       0xFFFFF000
 #define COPIED_PAGE_VADDR             0xFFFFF000
+// 空闲时预先清零物理帧使用的临时映射，只由空闲线程使用
+#define ZEROING_PAGE_VADDR            0xFFFFD000
+// 本地 APIC 寄存器页的映射，不可缓存
+#define APIC_VIRTUAL                  0xFFFFB000
+
+// 预先清零的物理帧池的容量
+#define ZERO_POOL_SIZE                64
+
+// 页表项和页目录项的标志位
+#define PAGE_PRESENT                  (1 << 0)
+#define PAGE_RW                       (1 << 1)
+#define PAGE_USER                     (1 << 2)
+#define PAGE_NOCACHE                  (1 << 4)
+#define PAGE_LARGE                    (1 << 7)
+#define PAGE_GLOBAL                   (1 << 8)
+#define PAGE_FLAGS_MASK               (PAGE_RW | PAGE_USER | PAGE_NOCACHE | PAGE_GLOBAL)
+// 使用页表项中操作系统可用的位，标记 fork 后被设为只读、写入时需要复制的页
+#define PAGE_COW                      (1 << 9)
+
+// page_Switch_Benchmark 每种情况测量的轮数
+#define PAGE_BENCHMARK_ROUNDS         1000
+
+// 不低于该地址的映射属于内核，在所有地址空间中相同，开启 PGE 后标记为全局页
+#define KERNEL_SPACE_START            0xC0000000
+#define KERNEL_PDE_START              (KERNEL_SPACE_START >> 22)
+// 页目录中映射页目录自身的页目录项，使所有页表出现在 PAGE_TABLES_VIRTUAL 处
+#define PAGE_DIR_SELF_INDEX           (PAGE_TABLES_VIRTUAL >> 22)
 
 // ********************* physical memory layout ********************************
 // 0x00000000 ... 0x00100000  boot & reserved                                1MB
 // 0x00100000 ... 0x00200000  kernel page tables                             1MB
-// 0x00200000 ... 0x00300000  kernel load                                    1MB
+// 0x00400000 ... 0x00500000  kernel load, 4MB aligned for PSE               1MB
+// 0x01eff000 ... 0x01fff000  kernel bin load, released after boot            1MB
 // 0x01fff000 ... 0x01ffffff  kernel stack                                   4KB
+// 其余可用内存由 E820 内存布局决定，物理帧位图和帧描述符放在第一段足够大的空闲内存中
 #define KERNEL_PAGE_DIR_PHY           0x00101000
+#define BOOT_RESERVED_SIZE            (2 * 1024 * 1024)
 
-#define PHYSICAL_MEM_SIZE             (32 * 1024 * 1024)
+// loader 把内核二进制文件和启动栈放在前 32MB 的末尾，机器至少需要这么多内存，
+// BIOS 不支持 E820 时也按这个大小管理物理内存
+#define PHYSICAL_MEM_MIN              (32 * 1024 * 1024)
 #define KERNEL_BIN_LOAD_SIZE          (1024 * 1024)
+#define KERNEL_BIN_LOAD_PHYSICAL_ADDR (PHYSICAL_MEM_MIN - PAGE_SIZE - KERNEL_BIN_LOAD_SIZE)
+
+// loader 通过 BIOS int 0x15, eax = 0xE820 得到的内存布局，保存在物理地址 0x500 处
+#define E820_MAP_VIRTUAL              (KERNEL_SPACE_START + 0x500)
+#define E820_MAX_ENTRIES              32
+#define E820_USABLE                   1
+// 物理帧位图和伙伴系统帧描述符的映射区间，可以描述约 4GB 物理内存
+#define FRAME_META_VIRTUAL            0xF0400000
+#define FRAME_META_MAX_SIZE           (16 * 1024 * 1024)
+
+/**
+ * @struct e820_entry
+ * @brief E820 内存布局中的一项，由 BIOS 填写，布局固定为 20 字节。
+ */
+typedef struct e820_entry
+{
+    uint64 base;
+    uint64 length;
+    uint32 type;                    /**< 1 表示可用内存，其余类型都不能分配。 */
+} __attribute__((packed)) e820_entry_t;
+
+typedef struct e820_map
+{
+    uint32 count;
+    e820_entry_t entries[E820_MAX_ENTRIES];
+} __attribute__((packed)) e820_map_t;
 
 /**
  * @struct page_table_entry
@@ -76,12 +144,20 @@ typedef struct page_table_entry
     uint32 rw       : 1;
     /* 用户位，决定该页表项对应物理页框的访问权限级别。值为 0 表示只有内核模式可以访问，值为 1 表示用户模式和内核模式都可以访问。*/
     uint32 user     : 1;
+    /* 页级写穿透位，值为 1 表示采用写穿透（write-through）缓存策略。*/
+    uint32 pwt      : 1;
+    /* 页级禁用缓存位，值为 1 表示该页不被缓存，通常用于内存映射的设备寄存器。*/
+    uint32 pcd      : 1;
     /* 访问位，记录该页表项对应物理页框是否被访问过。CPU 访问该页时会自动将此位置为 1，操作系统可定期清零该位来统计页面访问情况。*/
     uint32 accessed : 1;
     /* 脏位，指示该页表项对应物理页框的内容是否被修改过。CPU 对该页执行写操作时会自动将此位置为 1，用于页面置换时判断是否需要写回磁盘。*/
     uint32 dirty    : 1;
-    /* 未使用位，目前在页表项中未被使用。*/
-    uint32 unused   : 7;
+    /* 页属性表索引位，目前未使用，保持为 0。*/
+    uint32 pat      : 1;
+    /* 全局位，CR4.PGE 开启后，全局页的 TLB 项在重新加载 CR3 时不会被刷新。*/
+    uint32 global   : 1;
+    /* 操作系统可自由使用的位。*/
+    uint32 avail    : 3;
     /* 物理页框号，存储该页表项对应物理页框的起始地址的高 20 位。与偏移量组合可得到完整的物理地址。*/
     uint32 frame    : 20;
 } pte_t;
@@ -95,13 +171,21 @@ typedef struct page_directory_entry
     uint32 rw       : 1;
     /* 用户位，决定该页表项对应物理页框的访问权限级别。值为 0 表示只有内核模式可以访问，值为 1 表示用户模式和内核模式都可以访问。*/
     uint32 user     : 1;
-    /* 访问位，记录该页表项对应物理页框是否被访问过。CPU 访问该页时会自动将此位置为 1，操作系统可定期清零该位来统计页面访问情况。*/
+    /* 页级写穿透位。*/
+    uint32 pwt      : 1;
+    /* 页级禁用缓存位。*/
+    uint32 pcd      : 1;
+    /* 访问位，记录该页目录项是否被访问过。*/
     uint32 accessed : 1;
-    /* 脏位，指示该页表项对应物理页框的内容是否被修改过。CPU 对该页执行写操作时会自动将此位置为 1，用于页面置换时判断是否需要写回磁盘。*/
+    /* 脏位，仅对 4MB 大页有效。*/
     uint32 dirty    : 1;
-    /* 未使用位，目前在页表项中未被使用。*/
-    uint32 unused   : 7;
-    /* 物理页框号，存储该页表项对应物理页框的起始地址的高 20 位。与偏移量组合可得到完整的物理地址。*/
+    /* 页大小位，CR4.PSE 开启后，值为 1 表示该页目录项直接映射一个 4MB 大页，而不是指向页表。*/
+    uint32 ps       : 1;
+    /* 全局位，仅对 4MB 大页有效。*/
+    uint32 global   : 1;
+    /* 操作系统可自由使用的位。*/
+    uint32 avail    : 3;
+    /* 物理页框号。对于 4MB 大页，只有高 10 位有效，大页的物理地址必须 4MB 对齐。*/
     uint32 frame    : 20;
 } pde_t;
 
@@ -109,12 +193,42 @@ typedef struct page_directory_entry
 typedef struct page_directory
 {
     uint32 pdePhyAddress;
+    struct page_directory *next;    /**< 所有页目录组成的链表，用于同步内核空间的页目录项。 */
 } page_directory_t;
 
+void page_Zero(void* page);
+void page_Copy(void* dest, const void* src);
 void enable_Paging(void);
 void reload_Page_Directory(page_directory_t *pageDirectory);
 void map_Page(uint32 virtualAddress, int32 frame);
+bool map_Page_Frame(uint32 virtualAddress, uint32 frame, uint32 flags);
+uint32 map_Pages(uint32 virtualAddress, uint32 pages, uint32 flags);
+uint32 unmap_Pages(uint32 virtualAddress, uint32 pages, bool freeFrame);
+bool map_Large_Page(uint32 virtualAddress, int32 frame, uint32 flags);
+bool page_Large_Supported(void);
+bool page_Is_Large(uint32 virtualAddress);
+/**
+ * @struct zero_pool_stats
+ * @brief 预先清零的物理帧池的统计信息，用于调整 ZERO_POOL_SIZE。
+ */
+typedef struct zero_pool_stats
+{
+    uint32 frames;                  /**< 池中当前的帧数。 */
+    uint32 hits;                    /**< 需要清零的帧直接从池中取得的次数。 */
+    uint32 misses;                  /**< 池为空、只能同步清零的次数。 */
+    uint32 refills;                 /**< 空闲时清零并放入池中的帧数。 */
+} zero_pool_stats_t;
+
+bool page_Zero_Pool_Refill(void);
+void page_Zero_Pool_Get_Stats(zero_pool_stats_t *stats);
+void page_Zero_Pool_Dump(void);
+bool page_Directory_Create(page_directory_t *pageDirectory);
+bool page_Directory_Clone(page_directory_t *pageDirectory);
+void page_Directory_Destroy(page_directory_t *pageDirectory);
+page_directory_t* page_Kernel_Directory(void);
 void page_Table_Init(void);
+void page_Switch_Benchmark(uint32 pages);
+void double_Fault_Handler(uint32 errCode);
 void page_Table_Test(void);
 
 #endif // PAGE_TABLE_H
\ No newline at end of file
@@ -0,0 +1,370 @@
+/******************************************************************************
+* @file    Slab.c
+* @brief   固定大小内核对象缓存（slab）相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Slab.h"
+#include "Bitmap.h"
+
+static uint32 slabNextAddress = SLAB_START;
+static kmem_slab_t* freeSlabPages = nullptr;
+static yieldlock_t slabPageLock;
+static kmem_cache_t* cacheList = nullptr;
+
+/**
+ * @brief 为 slab 获取一页已映射的内存。
+ *
+ * 优先复用全局空闲页链表中的页，否则从 slab 虚拟地址区间中顺序取出一页，
+ * 并通过 map_Pages 为其分配物理帧。
+ *
+ * @return uint32 页的虚拟地址，地址区间耗尽时返回 0。
+ */
+static uint32 slab_Page_Alloc(void)
+{
+    uint32 address = 0;
+    yieldlock_Lock(&slabPageLock);
+    if (freeSlabPages != nullptr)
+    {
+        address = (uint32)freeSlabPages;
+        freeSlabPages = freeSlabPages->next;
+    }
+    else if (slabNextAddress < SLAB_END && map_Pages(slabNextAddress, 1, PAGE_RW) == 1)
+    {
+        address = slabNextAddress;
+        slabNextAddress += PAGE_SIZE;
+    }
+    yieldlock_Unlock(&slabPageLock);
+    return address;
+}
+
+static void slab_Page_Free(kmem_slab_t* slab)
+{
+    yieldlock_Lock(&slabPageLock);
+    slab->magic = 0;
+    slab->next = freeSlabPages;
+    freeSlabPages = slab;
+    yieldlock_Unlock(&slabPageLock);
+}
+
+static void slab_List_Push(kmem_slab_t** list, kmem_slab_t* slab)
+{
+    slab->prev = nullptr;
+    slab->next = *list;
+    if (*list != nullptr)
+    {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+static void slab_List_Remove(kmem_slab_t** list, kmem_slab_t* slab)
+{
+    if (slab->prev != nullptr)
+    {
+        slab->prev->next = slab->next;
+    }
+    else
+    {
+        *list = slab->next;
+    }
+    if (slab->next != nullptr)
+    {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static uint32 slab_Object_Start(void)
+{
+    return (sizeof(kmem_slab_t) + 3) & ~3;
+}
+
+/**
+ * @brief 计算对象在 slab 中的序号。
+ *
+ * @return int32 对象的序号，地址不在对象边界上或超出对象区域时返回 -1。
+ */
+static int32 slab_Object_Index(kmem_slab_t* slab, void* object)
+{
+    uint32 offset = (uint32)object - ((uint32)slab + slab_Object_Start());
+    if ((uint32)object < (uint32)slab + slab_Object_Start() || offset % slab->cache->objectSize != 0 ||
+        offset / slab->cache->objectSize >= slab->cache->objectsPerSlab)
+    {
+        return -1;
+    }
+    return (int32)(offset / slab->cache->objectSize);
+}
+
+/**
+ * @brief 为缓存新建一个 slab。
+ *
+ * 将新页切分为等大小的对象并串成空闲对象链表。链接指针保存在空闲对象的开头，
+ * 构造函数在每次分配时调用，而不是在这里调用。
+ *
+ * @param cache 指向缓存的指针。
+ * @return kmem_slab_t* 新建的 slab，无法获取内存页时返回 nullptr。
+ */
+static kmem_slab_t* slab_Create(kmem_cache_t* cache)
+{
+    uint32 page = slab_Page_Alloc();
+    if (page == 0)
+    {
+        monitor_Printf("slab: out of slab pages for cache %s\n", cache->name);
+        return nullptr;
+    }
+    kmem_slab_t* slab = (kmem_slab_t*)page;
+    slab->magic = SLAB_MAGIC;
+    slab->cache = cache;
+    slab->inUse = 0;
+    slab->freeList = nullptr;
+    memset(slab->allocMap, 0, sizeof(slab->allocMap));
+    // 逆序串联对象，使分配从低地址开始
+    uint32 objectStart = page + slab_Object_Start();
+    for (int32 i = cache->objectsPerSlab - 1; i >= 0; i--)
+    {
+        void* object = (void*)(objectStart + i * cache->objectSize);
+        *(void**)object = slab->freeList;
+        slab->freeList = object;
+    }
+    cache->slabNum++;
+    return slab;
+}
+
+/**
+ * @brief 创建一个固定大小对象的缓存。
+ *
+ * @param name 缓存名称，用于调试输出。
+ * @param objectSize 对象大小，会向上对齐到 4 字节且不小于一个指针。
+ * @param ctor 对象构造函数，可以为 nullptr。
+ * @return kmem_cache_t* 新建的缓存，对象过大或内存不足时返回 nullptr。
+ */
+kmem_cache_t* kmem_Cache_Create(char* name, uint32 objectSize, kmem_ctor_t ctor)
+{
+    if (objectSize < sizeof(void*))
+    {
+        objectSize = sizeof(void*);
+    }
+    objectSize = (objectSize + 3) & ~3;
+    if (objectSize > PAGE_SIZE - slab_Object_Start())
+    {
+        monitor_Printf("slab: object size %d too large for cache %s\n", objectSize, name);
+        return nullptr;
+    }
+    kmem_cache_t* cache = (kmem_cache_t*)kmalloc(sizeof(kmem_cache_t), NOT_PAGE_ALIGNED);
+    if (cache == nullptr)
+    {
+        return nullptr;
+    }
+    memset(cache, 0, sizeof(kmem_cache_t));
+    if (strlen(name) < sizeof(cache->name))
+    {
+        strcpy(cache->name, name);
+    }
+    cache->objectSize = objectSize;
+    cache->objectsPerSlab = (PAGE_SIZE - slab_Object_Start()) / objectSize;
+    cache->ctor = ctor;
+    yieldlock_Init(&cache->lock);
+    yieldlock_Lock(&slabPageLock);
+    cache->next = cacheList;
+    cacheList = cache;
+    yieldlock_Unlock(&slabPageLock);
+    return cache;
+}
+
+/**
+ * @brief 从缓存中分配一个对象。
+ *
+ * 优先从部分使用的 slab 中分配，其次复用全空的 slab，都没有时新建一个 slab。
+ * 分配只需从 slab 的空闲对象链表头部取出一个对象，为 O(1) 操作。
+ * 对象的开头在空闲时保存链表指针，因此构造函数在每次分配后调用。
+ *
+ * @param cache 指向缓存的指针。
+ * @return void* 分配的对象，内存不足时返回 nullptr。
+ */
+void* kmem_Cache_Alloc(kmem_cache_t* cache)
+{
+    yieldlock_Lock(&cache->lock);
+    kmem_slab_t* slab = cache->partialSlabs;
+    if (slab == nullptr)
+    {
+        slab = cache->emptySlabs;
+        if (slab != nullptr)
+        {
+            slab_List_Remove(&cache->emptySlabs, slab);
+            cache->emptySlabNum--;
+        }
+        else
+        {
+            slab = slab_Create(cache);
+            if (slab == nullptr)
+            {
+                yieldlock_Unlock(&cache->lock);
+                return nullptr;
+            }
+        }
+        slab_List_Push(&cache->partialSlabs, slab);
+    }
+    // 从 slab 的空闲对象链表头部取出一个对象
+    void* object = slab->freeList;
+    slab->freeList = *(void**)object;
+    slab->inUse++;
+    uint32 index = (uint32)slab_Object_Index(slab, object);
+    slab->allocMap[INDEX_FROM_BIT(index)] |= 1u << OFFSET_FROM_BIT(index);
+    // slab 已满，移动到全满链表
+    if (slab->freeList == nullptr)
+    {
+        slab_List_Remove(&cache->partialSlabs, slab);
+        slab_List_Push(&cache->fullSlabs, slab);
+    }
+    cache->activeObjects++;
+    cache->totalAllocs++;
+    yieldlock_Unlock(&cache->lock);
+    if (cache->ctor != nullptr)
+    {
+        cache->ctor(object);
+    }
+    return object;
+}
+
+/**
+ * @brief 将对象归还给缓存。
+ *
+ * 对象所在的 slab 通过页对齐直接得到，无需查找。slab 变为全空时，
+ * 缓存保留至多 SLAB_EMPTY_MAX 个空 slab，其余的页归还到全局空闲页链表供其他缓存使用。
+ * 不在对象边界上的地址和已经空闲的对象被拒绝，不会破坏空闲链表和计数。
+ *
+ * @param cache 指向缓存的指针。
+ * @param object 要释放的对象。
+ */
+void kmem_Cache_Free(kmem_cache_t* cache, void* object)
+{
+    if (object == nullptr)
+    {
+        return;
+    }
+    kmem_slab_t* slab = (kmem_slab_t*)((uint32)object & ~(PAGE_SIZE - 1));
+    if (slab->magic != SLAB_MAGIC || slab->cache != cache)
+    {
+        monitor_Printf("slab: invalid free %x for cache %s\n", object, cache->name);
+        return;
+    }
+    int32 index = slab_Object_Index(slab, object);
+    if (index < 0)
+    {
+        monitor_Printf("slab: free of interior pointer %x for cache %s\n", object, cache->name);
+        return;
+    }
+    yieldlock_Lock(&cache->lock);
+    if ((slab->allocMap[INDEX_FROM_BIT(index)] & (1u << OFFSET_FROM_BIT(index))) == 0)
+    {
+        yieldlock_Unlock(&cache->lock);
+        monitor_Printf("slab: double free %x for cache %s\n", object, cache->name);
+        return;
+    }
+    slab->allocMap[INDEX_FROM_BIT(index)] &= ~(1u << OFFSET_FROM_BIT(index));
+    bool wasFull = (slab->freeList == nullptr);
+    *(void**)object = slab->freeList;
+    slab->freeList = object;
+    slab->inUse--;
+    if (wasFull)
+    {
+        slab_List_Remove(&cache->fullSlabs, slab);
+        slab_List_Push(&cache->partialSlabs, slab);
+    }
+    if (slab->inUse == 0)
+    {
+        slab_List_Remove(&cache->partialSlabs, slab);
+        if (cache->emptySlabNum < SLAB_EMPTY_MAX)
+        {
+            slab_List_Push(&cache->emptySlabs, slab);
+            cache->emptySlabNum++;
+        }
+        else
+        {
+            cache->slabNum--;
+            slab_Page_Free(slab);
+        }
+    }
+    cache->activeObjects--;
+    cache->totalFrees++;
+    yieldlock_Unlock(&cache->lock);
+}
+
+bool kmem_Is_Slab_Object(void* address)
+{
+    return (uint32)address >= SLAB_START && (uint32)address < SLAB_END;
+}
+
+/**
+ * @brief 释放一个 slab 对象，所属缓存由对象所在 slab 的描述符得到。
+ *
+ * @param object 要释放的对象。
+ */
+void kmem_Free_Object(void* object)
+{
+    kmem_slab_t* slab = (kmem_slab_t*)((uint32)object & ~(PAGE_SIZE - 1));
+    if (slab->magic != SLAB_MAGIC)
+    {
+        monitor_Printf("slab: invalid free %x\n", object);
+        return;
+    }
+    kmem_Cache_Free(slab->cache, object);
+}
+
+void kmem_Cache_Dump(void)
+{
+    monitor_Printf("slab caches:\n");
+    for (kmem_cache_t* cache = cacheList; cache != nullptr; cache = cache->next)
+    {
+        monitor_Printf("  %s: size %d, slabs %d, active %d, allocs %d, frees %d\n",
+            cache->name, cache->objectSize, cache->slabNum,
+            cache->activeObjects, cache->totalAllocs, cache->totalFrees);
+    }
+}
+
+void kmem_Cache_Test(void)
+{
+    monitor_Printf("kmem_Cache_Test\n");
+    kmem_cache_t* cache = kmem_Cache_Create("test", 24, nullptr);
+    uint32* p1 = (uint32*)kmem_Cache_Alloc(cache);
+    uint32* p2 = (uint32*)kmem_Cache_Alloc(cache);
+    ASSERT(p1 != nullptr && p2 != nullptr && p1 != p2);
+    ASSERT((uint32)p2 - (uint32)p1 == cache->objectSize);
+    *p1 = 100;
+    *p2 = 101;
+    kmem_Cache_Free(cache, p1);
+    // 刚释放的对象位于空闲链表头部，会被立即复用
+    uint32* p3 = (uint32*)kmem_Cache_Alloc(cache);
+    ASSERT(p3 == p1);
+    kfree(p2);
+    kfree(p3);
+    ASSERT(cache->activeObjects == 0);
+    // 重复释放和对象内部的地址都应被拒绝，计数保持不变
+    kmem_Cache_Free(cache, p2);
+    kmem_Cache_Free(cache, (uint8*)p1 + 4);
+    ASSERT(cache->activeObjects == 0);
+    kmem_Cache_Dump();
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+* @file    Slab.h
+* @brief   固定大小内核对象缓存（slab）相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "Std_Types.h"
+#include "Page_Table.h"
+#include "Yieldlock.h"
+
+// slab 页所在的虚拟地址区间，紧跟在内核堆之后
+#define SLAB_START           0xE0000000
+#define SLAB_END             0xE4000000
+#define SLAB_MAGIC           0x51AB51AB
+
+// 每个缓存最多保留的空闲 slab 数量，多余的 slab 页归还到全局空闲页链表
+#define SLAB_EMPTY_MAX       1
+// 对象至少占一个指针，每个 slab 的对象数不超过 PAGE_SIZE / 4，分配位图按此确定大小
+#define SLAB_MAP_WORDS       ((PAGE_SIZE / sizeof(void*) + 31) / 32)
+
+typedef void (*kmem_ctor_t)(void* object);
+
+/**
+ * @struct kmem_slab
+ * @brief 一个 slab 占用一页，页首保存 slab 描述符，其余空间被切分为等大小的对象。
+ */
+struct kmem_slab
+{
+    uint32 magic;                   /**< 用于校验释放地址是否属于 slab。 */
+    struct kmem_cache *cache;       /**< slab 所属的缓存。 */
+    struct kmem_slab *prev;         /**< 缓存内 slab 链表的前驱。 */
+    struct kmem_slab *next;         /**< 缓存内 slab 链表的后继。 */
+    void *freeList;                 /**< 空闲对象单链表，链接指针保存在对象的开头。 */
+    uint32 inUse;                   /**< 已分配出去的对象数量。 */
+    uint32 allocMap[SLAB_MAP_WORDS]; /**< 第 i 位为 1 表示第 i 个对象已分配，用于发现重复释放。 */
+};
+typedef struct kmem_slab kmem_slab_t;
+
+/**
+ * @struct kmem_cache
+ * @brief 固定大小对象的缓存，按 slab 的使用情况分别挂在部分使用、全满、全空三个链表上。
+ */
+struct kmem_cache
+{
+    char name[32];
+    uint32 objectSize;              /**< 对齐后的对象大小。 */
+    uint32 objectsPerSlab;          /**< 每个 slab 能容纳的对象数量。 */
+    kmem_ctor_t ctor;               /**< 对象构造函数，每次分配时调用，空闲对象的开头被链表指针覆盖。 */
+    kmem_slab_t *partialSlabs;
+    kmem_slab_t *fullSlabs;
+    kmem_slab_t *emptySlabs;
+    uint32 emptySlabNum;
+    yieldlock_t lock;
+    uint32 slabNum;                 /**< 当前持有的 slab 数量。 */
+    uint32 activeObjects;           /**< 当前正在使用的对象数量。 */
+    uint32 totalAllocs;             /**< 累计分配次数。 */
+    uint32 totalFrees;              /**< 累计释放次数。 */
+    struct kmem_cache *next;        /**< 全局缓存链表。 */
+};
+typedef struct kmem_cache kmem_cache_t;
+
+kmem_cache_t* kmem_Cache_Create(char* name, uint32 objectSize, kmem_ctor_t ctor);
+void* kmem_Cache_Alloc(kmem_cache_t* cache);
+void kmem_Cache_Free(kmem_cache_t* cache, void* object);
+bool kmem_Is_Slab_Object(void* address);
+void kmem_Free_Object(void* object);
+void kmem_Cache_Dump(void);
+void kmem_Cache_Test(void);
+
+#endif // !SLAB_H
@@ -0,0 +1,154 @@
+/******************************************************************************
+* @file    Tlb.c
+* @brief   TLB 维护相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Tlb.h"
+#include "Cpu.h"
+
+static bool pgeEnabled = false;
+
+/**
+ * @brief 检测 CPU 是否支持 PGE，支持时设置 CR4.PGE 开启全局页。
+ *
+ * 开启后带有全局位的页表项在重新加载 CR3 时保留在 TLB 中，
+ * 切换地址空间时内核部分的映射无需重新填充。
+ *
+ * @return bool 开启成功时返回 true。
+ */
+bool tlb_Enable_Global(void)
+{
+    if (!cpu_Has_Feature(CPUID_FEATURE_PGE))
+    {
+        return false;
+    }
+    cpu_Write_Cr4(cpu_Read_Cr4() | CR4_PGE);
+    pgeEnabled = true;
+    return true;
+}
+
+/**
+ * @brief 关闭全局页，清除 CR4.PGE 的同时会刷新包括全局页在内的整个 TLB。
+ */
+void tlb_Disable_Global(void)
+{
+    cpu_Write_Cr4(cpu_Read_Cr4() & ~CR4_PGE);
+    pgeEnabled = false;
+}
+
+bool tlb_Global_Enabled(void)
+{
+    return pgeEnabled;
+}
+
+/**
+ * @brief 使用 invlpg 指令只刷新一页的 TLB 项。
+ *
+ * 页表项由不存在变为存在时，CPU 不会缓存不存在的页表项，无需刷新；
+ * 只有修改或删除已经存在的映射时才需要调用。
+ *
+ * @param virtualAddress 需要刷新的虚拟地址。
+ */
+void tlb_Flush_Page(uint32 virtualAddress)
+{
+    asm volatile("invlpg (%0)" : : "r"(virtualAddress) : "memory");
+}
+
+/**
+ * @brief 重新写入 CR3，刷新所有非全局页的 TLB 项。
+ *
+ * 开启 PGE 后内核映射的全局页不受影响，只有用户空间的映射被刷新。
+ */
+void tlb_Flush_User(void)
+{
+    uint32 cr3;
+    asm volatile("mov %%cr3, %0" : "=r"(cr3));
+    asm volatile("mov %0, %%cr3" : : "r"(cr3) : "memory");
+}
+
+/**
+ * @brief 刷新整个 TLB，包括全局页。
+ *
+ * 开启 PGE 时重新写入 CR3 不会刷新全局页，需要先清除再恢复 CR4.PGE。
+ */
+void tlb_Flush_All(void)
+{
+    if (pgeEnabled)
+    {
+        uint32 cr4 = cpu_Read_Cr4();
+        cpu_Write_Cr4(cr4 & ~CR4_PGE);
+        cpu_Write_Cr4(cr4);
+    }
+    else
+    {
+        tlb_Flush_User();
+    }
+}
+
+void tlb_Batch_Init(tlb_batch_t* batch)
+{
+    batch->count = 0;
+    batch->fullFlush = false;
+}
+
+void tlb_Batch_Add(tlb_batch_t* batch, uint32 virtualAddress)
+{
+    if (batch->fullFlush)
+    {
+        return;
+    }
+    if (batch->count >= TLB_BATCH_MAX)
+    {
+        batch->fullFlush = true;
+        return;
+    }
+    batch->addresses[batch->count++] = virtualAddress;
+}
+
+/**
+ * @brief 刷新批量中累积的页。
+ *
+ * 页数不超过 TLB_BATCH_MAX 时逐页 invlpg，否则整体刷新一次。
+ * 当前内核只运行在单核上，刷新本地 TLB 即可，无需向其他核心发送 shootdown 中断。
+ *
+ * @param batch 指向批量的指针，刷新后被清空。
+ */
+void tlb_Batch_Flush(tlb_batch_t* batch)
+{
+    if (batch->fullFlush)
+    {
+        tlb_Flush_All();
+    }
+    else
+    {
+        for (uint32 i = 0; i < batch->count; i++)
+        {
+            tlb_Flush_Page(batch->addresses[i]);
+        }
+    }
+    tlb_Batch_Init(batch);
+}
@@ -0,0 +1,59 @@
+/******************************************************************************
+* @file    Tlb.h
+* @brief   TLB 维护相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef TLB_H
+#define TLB_H
+
+#include "Std_Types.h"
+
+// 批量刷新的页数超过该阈值时，逐页 invlpg 的代价高于整体刷新后重新填充 TLB，改为整体刷新
+#define TLB_BATCH_MAX           32
+
+/**
+ * @struct tlb_batch
+ * @brief 在一次范围操作中累积需要刷新的页，操作结束后统一刷新。
+ */
+struct tlb_batch
+{
+    uint32 addresses[TLB_BATCH_MAX];
+    uint32 count;
+    bool fullFlush;                 /**< 超过阈值后只记录需要整体刷新。 */
+};
+typedef struct tlb_batch tlb_batch_t;
+
+bool tlb_Enable_Global(void);
+void tlb_Disable_Global(void);
+bool tlb_Global_Enabled(void);
+void tlb_Flush_Page(uint32 virtualAddress);
+void tlb_Flush_User(void);
+void tlb_Flush_All(void);
+void tlb_Batch_Init(tlb_batch_t* batch);
+void tlb_Batch_Add(tlb_batch_t* batch, uint32 virtualAddress);
+void tlb_Batch_Flush(tlb_batch_t* batch);
+
+#endif // !TLB_H
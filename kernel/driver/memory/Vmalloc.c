@@ -0,0 +1,167 @@
+/******************************************************************************
+* @file    Vmalloc.c
+* @brief   虚拟地址连续的大块内存分配相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Vmalloc.h"
+#include "Bitmap.h"
+#include "Yieldlock.h"
+
+// 第 i 位为 1 表示区间中的第 i 页已被占用（包括每个区域之后的保护页）
+static uint32 usedBits[VMALLOC_PAGES / 32];
+// 第 i 位为 1 表示第 i 页是一个区域的第一页，释放时据此拒绝区域内部和保护页的地址
+static uint32 startBits[VMALLOC_PAGES / 32];
+// 第 i 位为 1 表示第 i 页是一个区域的最后一页，释放时据此得到区域的长度
+static uint32 endBits[VMALLOC_PAGES / 32];
+static bitmap_t usedMap;
+static bitmap_t startMap;
+static bitmap_t endMap;
+static bool vmallocReady = false;
+static yieldlock_t vmallocLock;
+static uint32 vmallocPages = 0;
+static uint32 vmallocAreas = 0;
+
+static void vmalloc_Init(void)
+{
+    bitmap_Init(&usedMap, usedBits, VMALLOC_PAGES);
+    bitmap_Init(&startMap, startBits, VMALLOC_PAGES);
+    bitmap_Init(&endMap, endBits, VMALLOC_PAGES);
+    vmallocReady = true;
+}
+
+/**
+ * @brief 分配一段虚拟地址连续的内存。
+ *
+ * 在 vmalloc 区间中找到足够的连续页，通过 map_Pages 为其映射任意的空闲物理帧，
+ * 物理帧不必连续。每个区域之后保留一个不映射的保护页，越界访问会触发缺页异常。
+ *
+ * @param size 分配的字节数，向上取整到页。
+ * @return void* 页对齐的起始地址，虚拟地址或物理内存不足时返回 nullptr。
+ */
+void* vmalloc(uint32 size)
+{
+    if (size == 0)
+    {
+        return nullptr;
+    }
+    uint32 pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    uint32 index;
+    yieldlock_Lock(&vmallocLock);
+    if (!vmallocReady)
+    {
+        vmalloc_Init();
+    }
+    if (!bitmap_Allocate_Range(&usedMap, pages + 1, &index))
+    {
+        yieldlock_Unlock(&vmallocLock);
+        monitor_Printf("vmalloc: out of virtual space for %d pages\n", pages);
+        return nullptr;
+    }
+    bitmap_Set_Bit(&startMap, index);
+    bitmap_Set_Bit(&endMap, index + pages - 1);
+    vmallocPages += pages;
+    vmallocAreas++;
+    yieldlock_Unlock(&vmallocLock);
+    uint32 address = VMALLOC_START + index * PAGE_SIZE;
+    if (map_Pages(address, pages, PAGE_RW) != pages)
+    {
+        vfree((void*)address);
+        return nullptr;
+    }
+    return (void*)address;
+}
+
+/**
+ * @brief 释放 vmalloc 分配的内存，解除映射并归还物理帧。
+ *
+ * @param address vmalloc 返回的地址，区域内部或保护页的地址会被拒绝。
+ */
+void vfree(void* address)
+{
+    uint32 start = (uint32)address;
+    if (!vmalloc_Contains(start) || (start & (PAGE_SIZE - 1)) != 0 || !vmallocReady)
+    {
+        monitor_Printf("vfree: invalid address %x\n", address);
+        return;
+    }
+    uint32 index = (start - VMALLOC_START) / PAGE_SIZE;
+    yieldlock_Lock(&vmallocLock);
+    if (!bitmap_Get_Bit(&startMap, index))
+    {
+        yieldlock_Unlock(&vmallocLock);
+        monitor_Printf("vfree: invalid address %x\n", address);
+        return;
+    }
+    uint32 pages = 1;
+    while (!bitmap_Get_Bit(&endMap, index + pages - 1))
+    {
+        pages++;
+    }
+    yieldlock_Unlock(&vmallocLock);
+    // 先解除映射再释放地址区间，避免新的分配拿到仍然映射着的页
+    unmap_Pages(start, pages, true);
+    yieldlock_Lock(&vmallocLock);
+    bitmap_Clear_Bit(&startMap, index);
+    bitmap_Clear_Bit(&endMap, index + pages - 1);
+    bitmap_Clear_Range(&usedMap, index, pages + 1);
+    vmallocPages -= pages;
+    vmallocAreas--;
+    yieldlock_Unlock(&vmallocLock);
+}
+
+bool vmalloc_Contains(uint32 address)
+{
+    return address >= VMALLOC_START && address < VMALLOC_END;
+}
+
+void vmalloc_Dump(void)
+{
+    monitor_Printf("vmalloc: %d areas, %d pages\n", vmallocAreas, vmallocPages);
+}
+
+void vmalloc_Test(void)
+{
+    monitor_Printf("vmalloc_Test\n");
+    uint8* p1 = (uint8*)vmalloc(3 * PAGE_SIZE + 1);
+    uint8* p2 = (uint8*)vmalloc(PAGE_SIZE);
+    ASSERT(p1 != nullptr && p2 != nullptr);
+    ASSERT(((uint32)p1 & (PAGE_SIZE - 1)) == 0);
+    // 4 页数据加 1 页保护页
+    ASSERT((uint32)p2 == (uint32)p1 + 5 * PAGE_SIZE);
+    p1[0] = 1;
+    p1[4 * PAGE_SIZE - 1] = 2;
+    // 区域内部和保护页的地址不是区域的起始地址，不能释放
+    vfree(p1 + PAGE_SIZE);
+    vfree(p1 + 4 * PAGE_SIZE);
+    ASSERT(p1[0] == 1 && p1[4 * PAGE_SIZE - 1] == 2);
+    vfree(p1);
+    uint8* p3 = (uint8*)vmalloc(2 * PAGE_SIZE);
+    ASSERT(p3 != nullptr && p3[0] == 0);
+    vfree(p2);
+    vfree(p3);
+    vmalloc_Dump();
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+* @file    Vmalloc.h
+* @brief   虚拟地址连续的大块内存分配相关的头文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+#ifndef VMALLOC_H
+#define VMALLOC_H
+
+#include "Std_Types.h"
+#include "Page_Table.h"
+
+// vmalloc 使用的虚拟地址区间，位于 slab 页和内核栈之间
+#define VMALLOC_START        0xE4000000
+#define VMALLOC_END          0xEC000000
+#define VMALLOC_PAGES        ((VMALLOC_END - VMALLOC_START) / PAGE_SIZE)
+
+void* vmalloc(uint32 size);
+void vfree(void* address);
+bool vmalloc_Contains(uint32 address);
+void vmalloc_Dump(void);
+void vmalloc_Test(void);
+
+#endif // !VMALLOC_H
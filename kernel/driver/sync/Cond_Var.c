@@ -1,6 +1,23 @@
 #include "Cond_Var.h"
+#include "Timer.h"
 
 extern uint32 atomic_Exchange(volatile uint32* addr, uint32 val);
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
+
+/**
+ * @brief 带超时的等待者，放在等待线程的栈上，超时定时器通过它找到条件变量和线程节点。
+ *
+ * enqueued 只在关中断时修改，为 true 时线程节点在等待队列中或刚被通知移入就绪队列、尚未运行。
+ */
+struct cond_var_waiter
+{
+    cond_var_t *condVar;
+    thread_node_t *threadNode;
+    bool enqueued;
+    bool timedOut;
+};
+typedef struct cond_var_waiter cond_var_waiter_t;
 
 void cond_Var_Init(cond_var_t* condVar)
 {
@@ -27,10 +44,14 @@ void cond_Var_Wait(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func pr
     {
         // 获取当前线程的线程节点
         thread_node_t* threadNode = get_Current_Thread_Node();
+        // 等待队列可能被超时定时器在中断中修改，入队时关中断
+        uint32 eflags = get_Eflags();
+        disable_Interrupt();
         // 将当前线程节点添加到条件变量的等待线程队列中
         doubly_Linked_List_Append(&condVar->waitingThreadQueue, threadNode);
         // 标记当前线程为阻塞状态，等待条件满足
         schedule_Mark_Thread_Block();
+        set_Eflags(eflags);
         // 释放 yieldlock 锁，允许其他线程访问共享资源
         yieldlock_Unlock(lock);
         // 主动让出 CPU 时间片，让调度器调度其他线程运行
@@ -43,6 +64,77 @@ void cond_Var_Wait(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func pr
     yieldlock_Unlock(lock);
 }
 
+/**
+ * @brief 等待超时的定时器回调，在时钟中断中执行。
+ *
+ * 定时器只在线程入队到重新运行之间挂起，线程重新运行后立即取消，因此这期间线程只可能
+ * 阻塞在本条件变量上。仍阻塞时说明还没有被通知，将其从等待队列中摘除并唤醒；
+ * 已经被通知时只记录超时，由等待线程重新检查谓词决定结果。
+ */
+static void cond_Var_Timeout(void* data)
+{
+    cond_var_waiter_t* waiter = (cond_var_waiter_t*)data;
+    tcb_t* thread = (tcb_t*)waiter->threadNode->dataPtr;
+    waiter->timedOut = true;
+    if (waiter->enqueued && thread->status == THREAD_BLOCKED)
+    {
+        doubly_Linked_List_Remove(&waiter->condVar->waitingThreadQueue, waiter->threadNode);
+        waiter->enqueued = false;
+        add_Thread_Node_To_Schedule(waiter->threadNode);
+    }
+}
+
+/**
+ * @brief 带超时地等待条件变量满足特定条件。
+ *
+ * 与 cond_Var_Wait 相同，但每次入队时在时间轮上挂一个超时定时器，到期时即使没有被通知也会唤醒线程。
+ * 线程重新运行后先取消定时器再检查谓词，检查谓词时阻塞在别处也不会被超时回调误摘除。
+ * 等待期间线程不在就绪队列中，不会轮询。返回前锁已经释放。
+ *
+ * @param condVar 指向条件变量对象的指针。
+ * @param lock 指向 yieldlock 锁对象的指针，用于同步操作。
+ * @param predicator 指向谓词函数的指针，用于判断条件是否满足。
+ * @param ms 最长等待的毫秒数。
+ * @return bool 条件满足时返回 true，超时返回 false。
+ */
+bool cond_Var_Wait_Timeout(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func predicator, uint32 ms)
+{
+    cond_var_waiter_t waiter;
+    waiter.condVar = condVar;
+    waiter.threadNode = get_Current_Thread_Node();
+    waiter.enqueued = false;
+    waiter.timedOut = false;
+    kernel_timer_t timer;
+    uint32 deadline = timer_Ticks() + timer_Ms_To_Ticks(ms) + 1;
+    bool satisfied = true;
+    yieldlock_Lock(lock);
+    while (predicator != nullptr && predicator() == false)
+    {
+        uint32 eflags = get_Eflags();
+        disable_Interrupt();
+        if (waiter.timedOut || (int32)(timer_Ticks() - deadline) >= 0)
+        {
+            set_Eflags(eflags);
+            satisfied = false;
+            break;
+        }
+        doubly_Linked_List_Append(&condVar->waitingThreadQueue, waiter.threadNode);
+        waiter.enqueued = true;
+        timer_Add(&timer, cond_Var_Timeout, &waiter, deadline);
+        schedule_Mark_Thread_Block();
+        yieldlock_Unlock(lock);
+        schedule_Thread_Yield();
+        // 被通知或超时后重新运行，线程节点已经离开等待队列，超时定时器可能已经执行，
+        // 取消一个已执行的定时器什么也不做
+        timer_Cancel(&timer);
+        waiter.enqueued = false;
+        set_Eflags(eflags);
+        yieldlock_Lock(lock);
+    }
+    yieldlock_Unlock(lock);
+    return satisfied;
+}
+
 /**
  * @brief 通知一个等待在条件变量上的线程。
  * 
@@ -54,6 +146,9 @@ void cond_Var_Wait(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func pr
  */
 void cond_Var_Notify(cond_var_t* condVar)
 {
+    // 关中断，避免与超时定时器同时摘除同一个等待线程
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
     // 检查条件变量的等待队列中是否有等待的线程
     if (condVar->waitingThreadQueue.size != 0)
     {
@@ -64,4 +159,5 @@ void cond_Var_Notify(cond_var_t* condVar)
         // 将移除的线程节点添加到调度队列中，等待调度器调度
         add_Thread_Node_To_Schedule(head);
     }
+    set_Eflags(eflags);
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ typedef bool (*cv_predicator_func)();
 
 void cond_Var_Init(cond_var_t* condVar);
 void cond_Var_Wait(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func predicator);
+bool cond_Var_Wait_Timeout(cond_var_t* condVar, yieldlock_t* lock, cv_predicator_func predicator, uint32 ms);
 void cond_Var_Notify(cond_var_t* condVar);
 
 #endif // !COND_VAR_H
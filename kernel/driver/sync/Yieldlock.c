@@ -1,4 +1,5 @@
 #include "Yieldlock.h"
+#include "Timer.h"
 
 extern uint32 atomic_Exchange(volatile uint32* addr, uint32 val);
 
@@ -15,6 +16,27 @@ void yieldlock_Lock(yieldlock_t* lock)
     }
 }
 
+/**
+ * @brief 带超时地获取锁，最多尝试 ms 毫秒。
+ *
+ * 锁的持有时间很短，等待期间仍然让出 CPU 重试，超时以时钟中断计数判断。
+ *
+ * @return bool 获取到锁时返回 true，超时返回 false。
+ */
+bool yieldlock_Lock_Timeout(yieldlock_t* lock, uint32 ms)
+{
+    uint32 deadline = timer_Ticks() + timer_Ms_To_Ticks(ms);
+    while (atomic_Exchange(&lock->lock, LOCKED) != UNLOCKED)
+    {
+        if ((int32)(timer_Ticks() - deadline) >= 0)
+        {
+            return false;
+        }
+        schedule_Thread_Yield();
+    }
+    return true;
+}
+
 bool yieldlock_TryLock(yieldlock_t* lock)
 {
     return atomic_Exchange(&lock->lock, LOCKED) == UNLOCKED;
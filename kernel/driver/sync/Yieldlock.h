@@ -19,6 +19,7 @@ typedef struct yieldlock
 
 void yieldlock_Init(yieldlock_t* lock);
 void yieldlock_Lock(yieldlock_t* lock);
+bool yieldlock_Lock_Timeout(yieldlock_t* lock, uint32 ms);
 bool yieldlock_TryLock(yieldlock_t* lock);
 void yieldlock_Unlock(yieldlock_t* lock);
 
@@ -0,0 +1,281 @@
+/******************************************************************************
+* @file    Process.c
+* @brief   进程与地址空间管理相关的文件.
+* @details This is the detail description.
+* @author  ywBai <yw_bai@outlook.com>
+* @date    2026年10月18日 (created)
+* @version 0.0.1
+* @par Copyright (C):
+*          Bai, yuwei. All Rights Reserved.
+* @par Encoding:
+*          UTF-8
+* @par Description        :
+* 1. Hardware Descriptions:
+*      None.
+* 2. Program Architecture:
+*      None.
+* 3. File Usage:
+*      None.
+* 4. Limitations:
+*      None.
+* 5. Else:
+*      None.
+* @par Modification:
+* Date          : 2026年10月18日;
+* Revision         : 0.0.1;
+* Author           : ywBai;
+* Contents         :
+******************************************************************************/
+
+#include "Process.h"
+#include "Scheduler.h"
+#include "Slab.h"
+#include "Debug.h"
+
+static pcb_t kernelProcess;
+static kmem_cache_t* pcbCache = nullptr;
+static kmem_cache_t* pageDirectoryCache = nullptr;
+static uint32 nextPid = KERNEL_PROCESS_PID + 1;
+static yieldlock_t pidLock;
+
+static uint32 allocate_Pid(void)
+{
+    yieldlock_Lock(&pidLock);
+    uint32 pid = nextPid++;
+    yieldlock_Unlock(&pidLock);
+    return pid;
+}
+
+static void process_Struct_Init(pcb_t* process, uint32 pid, char* name, pcb_t* parent)
+{
+    memset(process, 0, sizeof(pcb_t));
+    process->pid = pid;
+    if (name != nullptr && strlen(name) < sizeof(process->name))
+    {
+        strcpy(process->name, name);
+    }
+    process->parent = parent;
+    process->status = PROCESS_NORMAL;
+    bitmap_Init(&process->userStackMap, process->userStackBits, USER_PROCESS_THREAD_MAX);
+    yieldlock_Init(&process->lock);
+}
+
+/**
+ * @brief 初始化内核进程，必须在创建第一个线程之前调用。
+ */
+void process_Init(void)
+{
+    yieldlock_Init(&pidLock);
+    process_Struct_Init(&kernelProcess, KERNEL_PROCESS_PID, "kernel", nullptr);
+    kernelProcess.pageDirectory = page_Kernel_Directory();
+    pcbCache = kmem_Cache_Create("pcb_t", sizeof(pcb_t), nullptr);
+    pageDirectoryCache = kmem_Cache_Create("page_directory_t", sizeof(page_directory_t), nullptr);
+}
+
+pcb_t* get_Kernel_Process(void)
+{
+    return &kernelProcess;
+}
+
+pcb_t* get_Current_Process(void)
+{
+    tcb_t* thread = get_Current_Thread();
+    if (thread == nullptr || thread->process == nullptr)
+    {
+        return &kernelProcess;
+    }
+    return thread->process;
+}
+
+/**
+ * @brief 分配进程结构和一个新的地址空间，用户空间为空。
+ *
+ * @param name 进程名称。
+ * @param parent 父进程。
+ * @return pcb_t* 新进程，内存不足时返回 nullptr。
+ */
+static pcb_t* process_Alloc(char* name, pcb_t* parent)
+{
+    pcb_t* process = (pcb_t*)kmem_Cache_Alloc(pcbCache);
+    if (process == nullptr)
+    {
+        return nullptr;
+    }
+    process_Struct_Init(process, allocate_Pid(), name, parent);
+    process->pageDirectory = (page_directory_t*)kmem_Cache_Alloc(pageDirectoryCache);
+    if (process->pageDirectory == nullptr || !page_Directory_Create(process->pageDirectory))
+    {
+        kmem_Cache_Free(pageDirectoryCache, process->pageDirectory);
+        kmem_Cache_Free(pcbCache, process);
+        return nullptr;
+    }
+    return process;
+}
+
+static void process_Free(pcb_t* process)
+{
+    page_Directory_Destroy(process->pageDirectory);
+    kmem_Cache_Free(pageDirectoryCache, process->pageDirectory);
+    kmem_Cache_Free(pcbCache, process);
+}
+
+/**
+ * @brief 在进程中创建一个线程并加入调度。
+ *
+ * 用户线程从 USER_STACK_TOP 向下分配一个用户栈，用户栈的页在第一次访问时按需映射。
+ * 新线程不带参数，用户栈上没有返回地址，线程函数不能返回。
+ *
+ * @param process 线程所属的进程。
+ * @param name 线程名称。
+ * @param function 线程函数。
+ * @param user 是否在用户态运行。
+ * @return tcb_t* 新线程，用户栈耗尽时返回 nullptr。
+ */
+static tcb_t* process_Create_Thread(pcb_t* process, char* name, void* function, bool user)
+{
+    uint32 stackIndex = 0;
+    if (user)
+    {
+        yieldlock_Lock(&process->lock);
+        bool allocated = bitmap_Allocate_First_Free_Bit(&process->userStackMap, &stackIndex);
+        yieldlock_Unlock(&process->lock);
+        if (!allocated)
+        {
+            monitor_Printf("process %d: out of user stacks\n", process->pid);
+            return nullptr;
+        }
+    }
+    tcb_t* thread = thread_Init(nullptr, name, function, THREAD_DEFAULT_PRIORITY, user);
+    if (thread == nullptr)
+    {
+        if (user)
+        {
+            yieldlock_Lock(&process->lock);
+            bitmap_Clear_Bit(&process->userStackMap, stackIndex);
+            yieldlock_Unlock(&process->lock);
+        }
+        return nullptr;
+    }
+    thread->process = process;
+    thread->pid = process->pid;
+    if (user)
+    {
+        thread->userStackIndex = stackIndex;
+        thread->userStack = USER_STACK_TOP - stackIndex * USER_STACK_SIZE;
+        interrupt_stack_t* interruptStack = (interrupt_stack_t*)(thread->kernelEsp + sizeof(switch_stack_t));
+        interruptStack->userEsp = thread->userStack;
+    }
+    yieldlock_Lock(&process->lock);
+    process->threadNum++;
+    yieldlock_Unlock(&process->lock);
+    add_Thread_To_Schedule(thread);
+    return thread;
+}
+
+/**
+ * @brief 创建一个新进程，用户空间为空，主线程从 function 开始执行。
+ *
+ * @param name 进程名称，同时作为主线程的名称。
+ * @param function 主线程函数。
+ * @param user 主线程是否在用户态运行。
+ * @return pcb_t* 新进程，内存不足时返回 nullptr。
+ */
+pcb_t* process_Create(char* name, void* function, bool user)
+{
+    pcb_t* process = process_Alloc(name, get_Current_Process());
+    if (process == nullptr)
+    {
+        return nullptr;
+    }
+    if (process_Create_Thread(process, name, function, user) == nullptr)
+    {
+        process_Free(process);
+        return nullptr;
+    }
+    return process;
+}
+
+/**
+ * @brief 复制当前进程，新进程的主线程从 function 开始执行。
+ *
+ * 子进程的用户空间是当前进程用户空间的写时复制副本：复制时只复制页表，
+ * 父子双方的页在第一次写入时才真正复制，未被写入的页一直共享。
+ * 子进程的第一个用户栈与父进程的第一个用户栈位于相同的地址，内容同样以写时复制的方式继承。
+ *
+ * @param name 子进程名称。
+ * @param function 子进程主线程函数。
+ * @param user 子进程主线程是否在用户态运行。
+ * @return pcb_t* 子进程，内存不足时返回 nullptr。
+ */
+pcb_t* process_Fork(char* name, void* function, bool user)
+{
+    pcb_t* parent = get_Current_Process();
+    pcb_t* child = process_Alloc(name, parent);
+    if (child == nullptr)
+    {
+        return nullptr;
+    }
+    if (!page_Directory_Clone(child->pageDirectory) ||
+        process_Create_Thread(child, name, function, user) == nullptr)
+    {
+        process_Free(child);
+        return nullptr;
+    }
+    return child;
+}
+
+/**
+ * @brief 线程销毁时从所属进程中移除，进程的最后一个线程被移除时释放进程的地址空间。
+ *
+ * 由清理线程调用，此时运行的是内核进程的地址空间，被释放的页目录不在使用中。
+ *
+ * @param thread 要移除的线程。
+ */
+void process_Remove_Thread(tcb_t* thread)
+{
+    pcb_t* process = thread->process;
+    if (process == nullptr || process == &kernelProcess)
+    {
+        return;
+    }
+    yieldlock_Lock(&process->lock);
+    if (thread->userStackIndex >= 0)
+    {
+        bitmap_Clear_Bit(&process->userStackMap, thread->userStackIndex);
+    }
+    uint32 threadNum = --process->threadNum;
+    yieldlock_Unlock(&process->lock);
+    if (threadNum == 0)
+    {
+        process_Free(process);
+    }
+}
+
+#define PROCESS_TEST_ADDR 0x10000000
+
+static void process_Test_Child()
+{
+    uint32* data = (uint32*)PROCESS_TEST_ADDR;
+    // 子进程看到的是 fork 时父进程的内容
+    ASSERT(*data == 100);
+    // 第一次写入触发写时复制
+    *data = 200;
+    ASSERT(*data == 200);
+    monitor_Printf("process_Test child %d: %d\n", get_Current_Process()->pid, *data);
+}
+
+static void process_Test_Parent()
+{
+    uint32* data = (uint32*)PROCESS_TEST_ADDR;
+    *data = 100;
+    ASSERT(process_Fork("processTestChild", process_Test_Child, false) != nullptr);
+    // 父进程的写入同样需要复制，或在子进程已经复制后直接恢复可写，都不影响子进程
+    *data = 101;
+    ASSERT(*data == 101);
+    monitor_Printf("process_Test parent %d: %d\n", get_Current_Process()->pid, *data);
+}
+
+void process_Test(void)
+{
+    process_Create("processTestParent", process_Test_Parent, false);
+}
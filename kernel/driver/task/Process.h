@@ -4,6 +4,7 @@
 #include "Thread.h"
 #include "Page_Table.h"
 #include "Yieldlock.h"
+#include "Bitmap.h"
 
 #define USER_STACK_TOP 0xBFC00000
 #define USER_STACK_SIZE 65536
@@ -15,12 +16,32 @@ enum process_status {
     PROCESS_EXIT_ZOMBIE
 };
 
+// 内核进程，所有内核线程都属于它，使用内核页目录
+#define KERNEL_PROCESS_PID 1
+
 struct process_struct
 {
     uint32 pid;
     char name[32];
     struct process_struct* parent;
     enum process_status status;
+    // 进程的地址空间，内核空间部分在所有进程中共享，用户空间部分私有
+    page_directory_t* pageDirectory;
+    // 进程中尚未销毁的线程数量，降为 0 时释放地址空间
+    uint32 threadNum;
+    // 用户栈的分配位图，第 i 位对应 USER_STACK_TOP 以下第 i 个 USER_STACK_SIZE 大小的用户栈
+    bitmap_t userStackMap;
+    uint32 userStackBits[USER_PROCESS_THREAD_MAX / 32];
+    yieldlock_t lock;
 };
+typedef struct process_struct pcb_t;
+
+void process_Init(void);
+pcb_t* get_Kernel_Process(void);
+pcb_t* get_Current_Process(void);
+pcb_t* process_Create(char* name, void* function, bool user);
+pcb_t* process_Fork(char* name, void* function, bool user);
+void process_Remove_Thread(tcb_t* thread);
+void process_Test(void);
 
 #endif //!PROCESS_H
\ No newline at end of file
@@ -29,24 +29,323 @@
 
 #include "Scheduler.h"
 #include "Cond_Var.h"
+#include "Process.h"
+#include "Timer.h"
 
 extern void cpu_Idle();
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
 extern void context_Switch(tcb_t* prev, tcb_t* next);
 extern void resume_Thread();
 
 
-static bool mainThreadInReadyQueue = false;
-
 static thread_node_t* currentThreadNode = nullptr;
 static bool multiThreadEnabled = false;
 static thread_node_t* mainThreadNode;
 static thread_node_t* cleanThreadNode;
 
 static doubly_linked_list_t deadThreadList;
-static doubly_linked_list_t readyThreadList;
+// 实时线程每个优先级一个 FIFO 就绪队列，rtReadyMap 的第 i 位为 1 表示第 i 级队列非空
+static doubly_linked_list_t rtReadyLists[THREAD_PRIORITY_LEVELS];
+static uint32 rtReadyMap;
+// 公平调度的就绪线程按虚拟运行时间组成的最小堆，fairMinVruntime 单调递增，用于放置新唤醒的线程
+static thread_node_t* fairHeap[SCHEDULE_FAIR_MAX_THREADS];
+static uint32 fairCount;
+static uint64 fairMinVruntime;
+// 最近两次相邻时钟中断之间的 TSC 周期数，作为公平调度的抢占粒度
+// 没有 TSC 时 scheduleTsc 为 false，运行时间按时钟中断数乘以 SCHEDULE_TICK_CYCLES 统计
+static bool scheduleTsc = false;
+static uint64 lastTickTsc;
+static uint32 lastTick;
+static uint32 tickCycles;
+static uint32 scheduleTicks;
 static yieldlock_t deadThreadLock;
 static cond_var_t deadThreadCondVar;
 
+// 2^32 / weight，weight = 1024 * 1.25^(priority - 10)，优先级每高一级，CPU 份额约增加 25%，
+// 默认优先级的权重为 1024，其虚拟运行时间与实际运行的周期数相同
+static const uint32 fairInverseWeight[THREAD_PRIORITY_LEVELS] =
+{
+    39045157, 31350126, 24970740, 19976592, 16025997, 12782640, 10250518, 8196502,
+    6557201, 5244160, 4194304, 3355443, 2684354, 2147483, 1717986, 1374389,
+    1099582, 879575, 703631, 562979, 450347, 360285, 288233, 230589,
+    184467, 147573, 118058, 94446, 75558, 60446, 48356, 38685,
+};
+
+/**
+ * @brief 公平调度使用的时钟，支持 TSC 时为 TSC 周期数，否则以时钟中断为粒度。
+ */
+static uint64 schedule_Clock(void)
+{
+    return scheduleTsc ? cpu_Read_Tsc() : (uint64)timer_Ticks() * SCHEDULE_TICK_CYCLES;
+}
+
+static uint32 thread_Time_Slice(tcb_t* thread)
+{
+    return max(thread->priority, THREAD_TIME_SLICE_MIN);
+}
+
+/**
+ * @brief 将线程节点放入其动态优先级对应的就绪队列，调用者需关中断。
+ *
+ * 时间片已用完的线程重新填充时间片并放到队尾；被抢占、仍有剩余时间片的线程放到队首，
+ * 下次轮到该优先级时先用完剩余的时间片。
+ *
+ * @param threadNode 线程节点。
+ * @param preempted 线程是否是在时间片用完之前被抢占的。
+ */
+static void rt_Queue_Push(thread_node_t* threadNode, bool preempted)
+{
+    tcb_t* thread = (tcb_t*)threadNode->dataPtr;
+    uint32 level = thread->dynamicPriority;
+    thread->readyTick = scheduleTicks;
+    if (thread->ticks == 0)
+    {
+        thread->ticks = thread_Time_Slice(thread);
+        preempted = false;
+    }
+    if (preempted)
+    {
+        doubly_Linked_List_Insert_Head(&rtReadyLists[level], threadNode);
+    }
+    else
+    {
+        doubly_Linked_List_Append(&rtReadyLists[level], threadNode);
+    }
+    rtReadyMap |= (1 << level);
+}
+
+static void rt_Queue_Remove(thread_node_t* threadNode)
+{
+    uint32 level = ((tcb_t*)threadNode->dataPtr)->dynamicPriority;
+    doubly_Linked_List_Remove(&rtReadyLists[level], threadNode);
+    if (rtReadyLists[level].size == 0)
+    {
+        rtReadyMap &= ~(1 << level);
+    }
+}
+
+/**
+ * @brief 取出优先级最高的就绪线程，调用者需关中断。
+ *
+ * 通过 rtReadyMap 和 bsr 指令直接找到最高的非空优先级，取该级队列的队首，为 O(1) 操作。
+ * 被选中的线程恢复为基础优先级，因等待而获得的提升只作用一次。
+ *
+ * @return thread_node_t* 线程节点，没有就绪线程时返回 nullptr。
+ */
+static thread_node_t* rt_Queue_Pop()
+{
+    if (rtReadyMap == 0)
+    {
+        return nullptr;
+    }
+    uint32 level = (uint32)bit_Scan_Reverse(rtReadyMap);
+    thread_node_t* threadNode = rtReadyLists[level].head;
+    rt_Queue_Remove(threadNode);
+    tcb_t* thread = (tcb_t*)threadNode->dataPtr;
+    thread->dynamicPriority = thread->priority;
+    return threadNode;
+}
+
+/**
+ * @brief 提升等待过久的就绪线程的动态优先级，调用者需关中断。
+ *
+ * 从高到低遍历 SCHEDULE_AGING_CEILING 以下的队列，提升到上一级的线程不会在同一轮中再次被提升。
+ * 被提升的线程重新开始计算等待时间，每等待 SCHEDULE_AGING_TICKS 提升一级。
+ */
+static void rt_Queue_Age()
+{
+    for (int32 level = SCHEDULE_AGING_CEILING - 1; level >= 0; level--)
+    {
+        thread_node_t* threadNode = rtReadyLists[level].head;
+        while (threadNode != nullptr)
+        {
+            thread_node_t* next = threadNode->next;
+            tcb_t* thread = (tcb_t*)threadNode->dataPtr;
+            if (scheduleTicks - thread->readyTick >= SCHEDULE_AGING_TICKS)
+            {
+                rt_Queue_Remove(threadNode);
+                thread->dynamicPriority = level + 1;
+                rt_Queue_Push(threadNode, false);
+            }
+            threadNode = next;
+        }
+    }
+}
+
+static uint64 fair_Vruntime(uint32 index)
+{
+    return ((tcb_t*)fairHeap[index]->dataPtr)->vruntime;
+}
+
+static void fair_Heap_Swap(uint32 a, uint32 b)
+{
+    thread_node_t* temp = fairHeap[a];
+    fairHeap[a] = fairHeap[b];
+    fairHeap[b] = temp;
+}
+
+static void fair_Heap_Push(thread_node_t* threadNode)
+{
+    if (fairCount >= SCHEDULE_FAIR_MAX_THREADS)
+    {
+        monitor_Printf("schedule: too many fair threads\n");
+        PANIC();
+    }
+    uint32 index = fairCount++;
+    fairHeap[index] = threadNode;
+    while (index > 0 && fair_Vruntime(index) < fair_Vruntime((index - 1) / 2))
+    {
+        fair_Heap_Swap(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+}
+
+static thread_node_t* fair_Heap_Pop()
+{
+    if (fairCount == 0)
+    {
+        return nullptr;
+    }
+    thread_node_t* threadNode = fairHeap[0];
+    fairHeap[0] = fairHeap[--fairCount];
+    uint32 index = 0;
+    while (true)
+    {
+        uint32 smallest = index;
+        uint32 left = index * 2 + 1;
+        uint32 right = left + 1;
+        if (left < fairCount && fair_Vruntime(left) < fair_Vruntime(smallest))
+        {
+            smallest = left;
+        }
+        if (right < fairCount && fair_Vruntime(right) < fair_Vruntime(smallest))
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        fair_Heap_Swap(index, smallest);
+        index = smallest;
+    }
+    return threadNode;
+}
+
+/**
+ * @brief 按线程的权重累加其自上次统计以来运行的时间，调用者需关中断。
+ *
+ * 虚拟运行时间的增量为实际运行的周期数（见 schedule_Clock）乘以 1024 / weight，通过倒数表换成乘法和移位，
+ * 避免 64 位除法。单次统计的周期数截断到 32 位，远大于一个时间片。
+ */
+static void fair_Update_Runtime(tcb_t* thread)
+{
+    uint64 now = schedule_Clock();
+    uint64 delta = now - thread->execStart;
+    uint32 cycles = (delta >> 32) ? 0xFFFFFFFF : (uint32)delta;
+    thread->execStart = now;
+    thread->vruntime += ((uint64)cycles * fairInverseWeight[thread->priority]) >> 22;
+}
+
+/**
+ * @brief 推进 fairMinVruntime，使其跟随当前线程和堆中虚拟运行时间最小的线程。
+ */
+static void fair_Update_Min(tcb_t* current)
+{
+    uint64 vruntime = (fairCount > 0) ? fair_Vruntime(0) : current->vruntime;
+    if (current->policy == THREAD_POLICY_FAIR && current->vruntime < vruntime)
+    {
+        vruntime = current->vruntime;
+    }
+    if (vruntime > fairMinVruntime)
+    {
+        fairMinVruntime = vruntime;
+    }
+}
+
+/**
+ * @brief 放置新建或刚被唤醒的公平调度线程。
+ *
+ * 睡眠期间虚拟运行时间不增长，唤醒后最多领先 fairMinVruntime 一个抢占粒度，
+ * 既能尽快运行，又不会因为睡眠过久而长时间独占 CPU。
+ */
+static void fair_Place(tcb_t* thread)
+{
+    uint64 floor = (fairMinVruntime > tickCycles) ? fairMinVruntime - tickCycles : 0;
+    if (thread->vruntime < floor)
+    {
+        thread->vruntime = floor;
+    }
+}
+
+/**
+ * @brief 将线程放入其调度类的就绪队列，调用者需关中断。
+ */
+static void ready_Queue_Push(thread_node_t* threadNode, bool preempted)
+{
+    if (((tcb_t*)threadNode->dataPtr)->policy == THREAD_POLICY_RT)
+    {
+        rt_Queue_Push(threadNode, preempted);
+    }
+    else
+    {
+        fair_Heap_Push(threadNode);
+    }
+}
+
+/**
+ * @brief 选出下一个运行的线程，实时线程总是优先于公平调度的线程，调用者需关中断。
+ */
+static thread_node_t* ready_Queue_Pop()
+{
+    thread_node_t* threadNode = rt_Queue_Pop();
+    if (threadNode == nullptr)
+    {
+        threadNode = fair_Heap_Pop();
+    }
+    return threadNode;
+}
+
+static bool ready_Queue_Empty()
+{
+    return rtReadyMap == 0 && fairCount == 0;
+}
+
+/**
+ * @brief 新就绪的线程应当先于当前线程运行时，标记当前线程需要重新调度，在中断返回时被抢占。
+ *
+ * 实时线程抢占公平调度的线程和优先级更低的实时线程；公平调度的线程只在虚拟运行时间
+ * 比当前线程少一个抢占粒度以上时才抢占，避免频繁切换。
+ */
+static void check_Preempt(tcb_t* thread)
+{
+    tcb_t* current = get_Current_Thread();
+    if (current == nullptr || current->status != THREAD_RUNNING)
+    {
+        return;
+    }
+    if (currentThreadNode == mainThreadNode)
+    {
+        current->needReSchedule = true;
+    }
+    else if (thread->policy == THREAD_POLICY_RT)
+    {
+        if (current->policy != THREAD_POLICY_RT || thread->dynamicPriority > current->dynamicPriority)
+        {
+            current->needReSchedule = true;
+        }
+    }
+    else if (current->policy == THREAD_POLICY_FAIR)
+    {
+        fair_Update_Runtime(current);
+        if (thread->vruntime + tickCycles < current->vruntime)
+        {
+            current->needReSchedule = true;
+        }
+    }
+}
+
 static bool is_Dead_thread()
 {
     return deadThreadList.size > 0;
@@ -67,7 +366,7 @@ static void kernel_Clean_Thread()
                 doubly_Linked_List_Remove(&deadThreadReceiver, deadThreadNode);
                 tcb_t* thread = (tcb_t*)deadThreadNode->dataPtr;
                 destroy_Thread(thread);
-                kfree(deadThreadNode);
+                doubly_Linked_List_Node_Free(deadThreadNode);
             }
         }
         schedule_Thread_Yield();
@@ -82,7 +381,8 @@ static void kernel_Init_Thread()
 static void kernel_Main_Thread()
 {
     tcb_t* cleanThread = thread_Init(nullptr, "cleanThread", kernel_Clean_Thread, THREAD_DEFAULT_PRIORITY, false);
-    cleanThreadNode = (thread_node_t*)kmalloc(sizeof(thread_node_t), NOT_PAGE_ALIGNED);
+    cleanThreadNode = doubly_Linked_List_Node_Alloc();
+    ASSERT(cleanThread != nullptr && cleanThreadNode != nullptr);
     cleanThreadNode->dataPtr = cleanThread;
     add_Thread_Node_To_Schedule(cleanThreadNode);
     tcb_t* initThread = thread_Init(nullptr, "initThread", kernel_Init_Thread, THREAD_DEFAULT_PRIORITY, false);
@@ -90,55 +390,94 @@ static void kernel_Main_Thread()
     multiThreadEnabled = true;
     enable_Interrupt();
     monitor_Printf("kernel main thread start!\n");
+    // 主线程只在没有其他就绪线程时运行，相当于最低优先级的空闲线程，
+    // 此时先为缺页处理预先清零物理帧，帧池已满后才停机等待中断。
+    // 停机前停止周期时钟，检查就绪队列和停机之间关中断，cpu_Idle 开中断后立即停机
     while(1) {
-        cpu_Idle();
+        if (!page_Zero_Pool_Refill())
+        {
+            disable_Interrupt();
+            if (ready_Queue_Empty())
+            {
+                timer_Nohz_Enter();
+                cpu_Idle();
+                timer_Nohz_Exit();
+            }
+            else
+            {
+                // 已有就绪线程时不必等到下一次时钟中断，直接让出 CPU
+                schedule_Thread_Yield();
+            }
+        }
     }
 }
 
 /**
- * @brief 执行上下文切换操作。
+ * @brief 执行上下文切换操作，调用者需关中断。
+ *
+ * 被抢占的线程先放回就绪队列，再选择优先级最高的线程，同一优先级的线程轮流运行。
+ * 主动让出 CPU 的线程在选择之后才放回队列，即使其他就绪线程的优先级更低也会让给它们，
+ * 避免高优先级线程在 yieldlock 上自旋时一直选中自己，持有锁的低优先级线程无法运行。
+ * 没有就绪线程时运行主线程。
  *
- * 此函数负责从就绪线程列表中选取下一个要执行的线程，
- * 并将当前线程状态更新后，执行上下文切换到下一个线程。
+ * @param yield 是否是当前线程主动让出 CPU。
  */
-static void do_Context_Switch()
+static void do_Context_Switch(bool yield)
 {
     // 获取当前正在运行的线程控制块指针
     tcb_t* oldThread = get_Current_Thread();
-    // 获取就绪线程列表的头节点
-    thread_node_t* head = readyThreadList.head;
-    // 从就绪线程列表的头节点中获取下一个要执行的线程控制块指针
-    tcb_t* nextThread = (tcb_t*)head->dataPtr;
-
-    // 若当前线程状态为运行中，且当前线程节点不是主线程节点
-    if (oldThread->status == THREAD_RUNNING && currentThreadNode != mainThreadNode)
+    thread_node_t* oldThreadNode = currentThreadNode;
+    // 仍在运行的线程需要放回就绪队列，主线程只在没有其他就绪线程时运行，不进入就绪队列
+    bool requeue = (oldThread->status == THREAD_RUNNING && oldThreadNode != mainThreadNode);
+    if (requeue)
     {
-        // 将当前线程状态更新为就绪状态
         oldThread->status = THREAD_READY;
-        // 将当前线程节点重新添加到就绪线程列表的尾部
-        doubly_Linked_List_Append(&readyThreadList, currentThreadNode);
     }
+    if (oldThread->policy == THREAD_POLICY_FAIR && oldThreadNode != mainThreadNode)
+    {
+        fair_Update_Runtime(oldThread);
+    }
+    if (requeue && !yield)
+    {
+        ready_Queue_Push(oldThreadNode, oldThread->ticks > 0);
+    }
+    thread_node_t* nextThreadNode = ready_Queue_Pop();
+    if (requeue && yield)
+    {
+        ready_Queue_Push(oldThreadNode, false);
+        if (nextThreadNode == nullptr)
+        {
+            nextThreadNode = ready_Queue_Pop();
+        }
+    }
+    if (nextThreadNode == nullptr)
+    {
+        nextThreadNode = mainThreadNode;
+    }
+    // 离开空闲的主线程时恢复周期时钟，就绪的线程才能按时间片被抢占
+    if (oldThreadNode == mainThreadNode && nextThreadNode != mainThreadNode)
+    {
+        timer_Nohz_Exit();
+    }
+    tcb_t* nextThread = (tcb_t*)nextThreadNode->dataPtr;
 
-    // 将当前线程的时间片计数重置为 0
-    oldThread->ticks = 0;
     // 标记当前线程不需要重新调度
     oldThread->needReSchedule = false;
 
-    // 将下一个要执行的线程状态更新为运行中
+    // 将下一个要执行的线程状态更新为运行中，从现在开始统计其运行时间
     nextThread->status = THREAD_RUNNING;
-    // 更新当前线程节点为就绪线程列表的头节点
-    currentThreadNode = head;
-
-    // 若就绪线程列表的头节点是主线程节kernel_Main_Thread点
-    if (head == mainThreadNode)
-    {
-        // 标记主线程不在就绪队列中
-        mainThreadInReadyQueue = false;
-    }
+    nextThread->execStart = schedule_Clock();
+    currentThreadNode = nextThreadNode;
 
     // 更新 TSS（任务状态段）中的栈指针，使其指向新线程的内核栈顶部
     updateTssEsp(nextThread->kernelStack + KERNEL_STACK_SIZE);
 
+    // 切换到其他进程的线程时切换地址空间，内核空间的映射是全局页，切换后仍保留在 TLB 中
+    if (nextThread->process != oldThread->process)
+    {
+        reload_Page_Directory(nextThread->process->pageDirectory);
+    }
+
     // 调用上下文切换函数，从当前线程切换到下一个线程
     context_Switch(oldThread, nextThread);
 }
@@ -162,7 +501,11 @@ void add_Dead_Thread(tcb_t* thread)
 {
     // 添加死亡线程的操作
     thread->status = THREAD_DEAD;
-    doubly_Linked_List_Append_Data(&deadThreadList, thread);
+    if (!doubly_Linked_List_Append_Data(&deadThreadList, thread))
+    {
+        // 线程无法交给清理线程回收，它的线程控制块和内核栈会泄漏
+        monitor_Printf("schedule: out of memory, leak dead thread %s\n", thread->name);
+    }
 }
 
 
@@ -178,13 +521,22 @@ void schedule_Thread_Exit()
 
 void add_Thread_To_Schedule(tcb_t* thread)
 {
-    thread_node_t* threadNode = (thread_node_t*)kmalloc(sizeof(thread_node_t), NOT_PAGE_ALIGNED);
+    thread_node_t* threadNode = doubly_Linked_List_Node_Alloc();
+    if (threadNode == nullptr)
+    {
+        monitor_Printf("schedule: out of memory, cannot schedule thread %s\n", thread->name);
+        PANIC();
+    }
     threadNode->dataPtr = (void*)thread;
     add_Thread_Node_To_Schedule(threadNode);
 }
 
+/**
+ * @brief 将线程加入就绪队列，可以在中断上下文中调用，例如定时器回调唤醒线程。
+ */
 void add_Thread_Node_To_Schedule(thread_node_t* threadNode)
 {
+    uint32 eflags = get_Eflags();
     disable_Interrupt();
     tcb_t* thread = (tcb_t*)threadNode->dataPtr;
     if (thread->status != THREAD_DEAD)
@@ -192,42 +544,42 @@ void add_Thread_Node_To_Schedule(thread_node_t* threadNode)
         thread->status = THREAD_READY;
     }
     // 添加线程到调度器的操作
-    doubly_Linked_List_Append(&readyThreadList, threadNode);
-    enable_Interrupt();
+    if (thread->policy == THREAD_POLICY_FAIR)
+    {
+        fair_Place(thread);
+    }
+    ready_Queue_Push(threadNode, false);
+    check_Preempt(thread);
+    set_Eflags(eflags);
 }
 
 void add_Thread_To_Schedule_Head(thread_node_t* threadNode)
 {
+    uint32 eflags = get_Eflags();
     disable_Interrupt();
     tcb_t* thread = (tcb_t*)threadNode->dataPtr;
     thread->status = THREAD_READY;
-    // 添加线程到调度器的操作
-    doubly_Linked_List_Append(&readyThreadList, threadNode);
-    enable_Interrupt();
+    // 实时线程放到同一优先级就绪队列的队首
+    if (thread->policy == THREAD_POLICY_FAIR)
+    {
+        fair_Place(thread);
+    }
+    ready_Queue_Push(threadNode, true);
+    check_Preempt(thread);
+    set_Eflags(eflags);
 }
 
 /**
  * @brief 让当前线程主动让出 CPU 使用权。
  *
- * 此函数会检查就绪线程列表是否为空，如果为空，则将主线程节点添加到就绪线程列表中，
- * 以确保系统中有可运行的线程。在操作过程中会禁用中断，防止并发问题。
+ * 其他线程都不就绪时，仍在运行的线程继续运行，已阻塞的线程切换到主线程。
+ * 在操作过程中会禁用中断，防止并发问题，切换回来时由 context_Switch 重新开启中断。
  */
 void schedule_Thread_Yield()
 {
-    // 禁用中断，避免在操作就绪线程列表时被中断干扰，保证操作的原子性
+    // 禁用中断，避免在操作就绪队列时被中断干扰，保证操作的原子性
     disable_Interrupt();
-
-    // 检查就绪线程列表的大小是否为 0，即列表中是否没有就绪线程
-    if (readyThreadList.size == 0)
-    {
-        // 若就绪线程列表为空，将主线程节点添加到就绪线程列表的尾部
-        doubly_Linked_List_Append(&readyThreadList, mainThreadNode);
-        // 标记主线程已在就绪队列中
-        mainThreadInReadyQueue = true;
-    }
-
-    // 操作完成后，重新启用中断，允许系统响应外部中断
-    do_Context_Switch();
+    do_Context_Switch(true);
 }
 
 void schedule_Mark_Thread_Block()
@@ -236,6 +588,38 @@ void schedule_Mark_Thread_Block()
     current->status = THREAD_BLOCKED;
 }
 
+static void thread_Sleep_Wakeup(void* data)
+{
+    add_Thread_Node_To_Schedule((thread_node_t*)data);
+}
+
+/**
+ * @brief 当前线程睡眠至少 ms 毫秒。
+ *
+ * 线程被标记为阻塞并离开就绪队列，由时间轮上的定时器在到期时重新加入就绪队列，
+ * 睡眠期间不占用任何调度开销。定时器放在栈上，不需要分配内存。
+ * 不足一个时钟中断的部分向上取整，并额外加一个时钟中断，因为当前时钟周期已经过去了一部分。
+ * 主线程是空闲线程，不能睡眠。
+ *
+ * @param ms 睡眠的毫秒数，为 0 时只让出 CPU。
+ */
+void thread_Sleep(uint32 ms)
+{
+    if (ms == 0 || currentThreadNode == mainThreadNode)
+    {
+        schedule_Thread_Yield();
+        return;
+    }
+    kernel_timer_t timer;
+    uint32 eflags = get_Eflags();
+    // 添加定时器到切换线程之间关中断，保证定时器回调只会看到已经阻塞的线程
+    disable_Interrupt();
+    timer_Add(&timer, thread_Sleep_Wakeup, currentThreadNode, timer_Ticks() + timer_Ms_To_Ticks(ms) + 1);
+    schedule_Mark_Thread_Block();
+    schedule_Thread_Yield();
+    set_Eflags(eflags);
+}
+
 
 /**
  * @brief 初始化调度器。
@@ -246,8 +630,16 @@ void schedule_Mark_Thread_Block()
 void schedule_Init()
 {
     // 初始化调度器的操作
-    // 初始化就绪线程列表，为后续添加就绪线程做准备
-    doubly_Linked_List_Init(&readyThreadList);
+    // 初始化各个优先级的就绪队列，为后续添加就绪线程做准备
+    for (uint32 i = 0; i < THREAD_PRIORITY_LEVELS; i++)
+    {
+        doubly_Linked_List_Init(&rtReadyLists[i]);
+    }
+    rtReadyMap = 0;
+    fairCount = 0;
+    // 没有 TSC 的处理器上执行 rdtsc 会触发 #UD，公平调度改为按时钟中断统计运行时间
+    scheduleTsc = cpu_Has_Feature(CPUID_FEATURE_TSC);
+    tickCycles = scheduleTsc ? 0 : SCHEDULE_TICK_CYCLES;
     // 初始化死亡线程列表，用于存放退出的线程
     doubly_Linked_List_Init(&deadThreadList);
     // 创建一个新的线程，作为内核主线程
@@ -255,8 +647,11 @@ void schedule_Init()
     // thread_Test();
     // tcb_t* mainThread = thread_Init(nullptr, "kernel_main", kernel_Main_Thread, THREAD_DEFAULT_PRIORITY, false);
     // 为线程节点分配内存，用于存储主线程的信息
+    // 线程控制块缓存在创建主线程之前一次性创建，此时还没有其他线程
+    thread_Cache_Init();
     tcb_t* mainThread = thread_Init(nullptr, "mainThread", kernel_Main_Thread, THREAD_DEFAULT_PRIORITY, false);
-    mainThreadNode = (thread_node_t*)kmalloc(sizeof(thread_node_t), NOT_PAGE_ALIGNED);
+    mainThreadNode = doubly_Linked_List_Node_Alloc();
+    ASSERT(mainThread != nullptr && mainThreadNode != nullptr);
     mainThreadNode->dataPtr = mainThread;
     // 将主线程的控制块指针存储到线程节点的数据指针中
     // mainThreadNode->dataPtr = mainThread;
@@ -267,6 +662,18 @@ void schedule_Init()
         jmp resume_Thread": : "g" (mainThread->kernelEsp) : "memory");
 }
 
+/**
+ * @brief 设置线程的调度类，只能在线程加入调度器之前调用。
+ *
+ * @param thread 线程控制块。
+ * @param policy THREAD_POLICY_FAIR 或 THREAD_POLICY_RT。
+ */
+void schedule_Set_Policy(tcb_t* thread, uint8 policy)
+{
+    thread->policy = policy;
+    thread->dynamicPriority = thread->priority;
+}
+
 void disable_Preempt()
 {
     get_Current_Thread()->preemptCount += 1;
@@ -286,16 +693,71 @@ void schedule()
         return;
     }
     bool needContextSwitch = false;
-    if (readyThreadList.size > 0)
+    if (!ready_Queue_Empty())
     {
         needContextSwitch = currentThread->needReSchedule;
     }
     if (needContextSwitch)
     {
-        do_Context_Switch();
+        do_Context_Switch(false);
     }
     else
     {
         enable_Interrupt();
     }
 }
+
+/**
+ * @brief 时钟中断中的调度处理。
+ *
+ * 实时线程消耗时间片，用完时标记重新调度；公平调度的线程累加虚拟运行时间，
+ * 不再是最小值时标记重新调度；主线程只要有就绪线程就让出 CPU。
+ * 同时定期提升等待过久的实时线程的优先级。
+ */
+void schedule_Tick()
+{
+    tcb_t* currentThread = get_Current_Thread();
+    if (currentThread == nullptr)
+    {
+        return;
+    }
+    scheduleTicks++;
+    // 空闲时跳过的时钟中断不计入抢占粒度，只测量相邻两次时钟中断的间隔
+    uint64 now = schedule_Clock();
+    uint32 tick = timer_Ticks();
+    if (lastTickTsc != 0 && tick - lastTick == 1)
+    {
+        tickCycles = (uint32)(now - lastTickTsc);
+    }
+    lastTickTsc = now;
+    lastTick = tick;
+    if (currentThreadNode == mainThreadNode)
+    {
+        currentThread->needReSchedule = !ready_Queue_Empty();
+    }
+    else if (currentThread->policy == THREAD_POLICY_RT)
+    {
+        if (currentThread->ticks > 0)
+        {
+            currentThread->ticks--;
+        }
+        if (currentThread->ticks == 0)
+        {
+            currentThread->needReSchedule = true;
+        }
+    }
+    else
+    {
+        // 公平调度的线程在虚拟运行时间超过最小值一个抢占粒度后让出 CPU，有实时线程就绪时立即让出
+        fair_Update_Runtime(currentThread);
+        fair_Update_Min(currentThread);
+        if (rtReadyMap != 0 || (fairCount > 0 && currentThread->vruntime > fair_Vruntime(0) + tickCycles))
+        {
+            currentThread->needReSchedule = true;
+        }
+    }
+    if (scheduleTicks % SCHEDULE_AGING_INTERVAL == 0)
+    {
+        rt_Queue_Age();
+    }
+}
@@ -33,6 +33,17 @@
 #include "Thread.h"
 #include "Gdt.h"
 
+// 公平调度就绪堆的容量，不少于内核栈的槽位数，每个线程都占用一个内核栈
+#define SCHEDULE_FAIR_MAX_THREADS  2048
+// 处理器不支持 TSC 时按时钟中断统计运行时间，每个时钟中断折合的周期数
+#define SCHEDULE_TICK_CYCLES       1000000
+
+// 实时线程等待超过 SCHEDULE_AGING_TICKS 个时钟中断仍未运行时，动态优先级提升一级，
+// 每 SCHEDULE_AGING_INTERVAL 个时钟中断检查一次
+#define SCHEDULE_AGING_TICKS     25
+#define SCHEDULE_AGING_INTERVAL  5
+// 提升不会超过该优先级，更高的优先级留给对延迟敏感的线程，保证它们总能确定地抢占其他线程
+#define SCHEDULE_AGING_CEILING   23
 
 tcb_t* get_Current_Thread();
 thread_node_t* get_Current_Thread_Node();
@@ -40,6 +51,7 @@ void add_Dead_Thread(tcb_t* thread);
 void schedule_Thread_Exit();
 void schedule_Init();
 void schedule_Mark_Thread_Block();
+void thread_Sleep(uint32 ms);
 void schedule_Thread_Yield();
 void add_Thread_To_Schedule_Head(thread_node_t* threadNode);
 void add_Thread_Node_To_Schedule(thread_node_t* threadNode);
@@ -49,4 +61,6 @@ void add_Dead_Thread(tcb_t* thread);
 void disable_Preempt();
 void enable_Preempt();
 void schedule();
+void schedule_Tick();
+void schedule_Set_Policy(tcb_t* thread, uint8 policy);
 #endif // !SCHEDULER_H
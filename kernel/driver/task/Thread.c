@@ -28,44 +28,64 @@
 ******************************************************************************/
 #include "Thread.h"
 #include "Scheduler.h"
+#include "Slab.h"
+#include "Process.h"
+#include "Kstack.h"
 extern void resume_Thread();
 extern void switch_To_User_Mode();
 
+static kmem_cache_t* tcbCache = nullptr;
+
 static void kernel_Thread(threadFunc* function) {
     function();
     schedule_Thread_Exit();
 }
 
 
+/**
+ * @brief 创建线程控制块缓存，在 schedule_Init 创建主线程之前调用一次，此时还没有其他线程。
+ */
+void thread_Cache_Init(void)
+{
+    tcbCache = kmem_Cache_Create("tcb_t", sizeof(tcb_t), nullptr);
+}
+
 /**
  * @brief 初始化一个线程控制块 (TCB)。
  *
  * 该函数用于初始化一个线程控制块，若传入的线程指针为空，则会分配新的内存。
- * 函数会设置线程的 PID、名称、状态、优先级等信息，并为线程分配内核栈。
+ * 函数会设置线程的 PID、名称、状态、优先级等信息，并从内核栈缓存中为线程分配内核栈。
  *
  * @param thread 指向线程控制块的指针，若为 nullptr 则分配新的内存。
  * @param name 线程的名称，若为 nullptr 则自动生成名称。
  * @param function 线程要执行的函数指针。
  * @param priority 线程的优先级。
  * @param user 用户标志（具体含义取决于实现）。
- * @return tcb_t* 初始化后的线程控制块指针。
+ * @return tcb_t* 初始化后的线程控制块指针，线程控制块或内核栈耗尽时返回 nullptr。
  */
 tcb_t* thread_Init(tcb_t* thread, char* name, void* function, uint32 priority, uint8 user)
 {
     // 若传入的线程指针为空，则分配新的线程控制块内存并初始化为 0
+    bool allocated = (thread == nullptr);
     if (thread == nullptr) {
         // Allocate one page as tcb_t and kernel stack for each thread.
-        // 为线程控制块分配内存，不按页对齐
-        thread = (tcb_t*)kmalloc(sizeof(tcb_t), NOT_PAGE_ALIGNED);
+        // 从线程控制块缓存中分配内存
+        ASSERT(tcbCache != nullptr);
+        thread = (tcb_t*)kmem_Cache_Alloc(tcbCache);
+        if (thread == nullptr)
+        {
+            monitor_Printf("thread_Init: out of memory for tcb\n");
+            return nullptr;
+        }
         // 将分配的内存初始化为 0
         memset(thread, 0, sizeof(tcb_t));
         // 打印线程控制块的地址
         monitor_Printf("thread_Init: thread = %x\n", thread);
     }
-    // 初始化线程的 PID 为 1
-    uint32 pid = 1;
+    // 线程默认属于内核进程，其他进程的线程由进程模块重新设置
+    thread->process = get_Kernel_Process();
     // 设置线程的 PID
-    thread->pid = pid;
+    thread->pid = thread->process->pid;
     // 若传入的线程名称不为空，则复制该名称到线程控制块中
     if (name != nullptr)
     {
@@ -84,28 +104,32 @@ tcb_t* thread_Init(tcb_t* thread, char* name, void* function, uint32 priority, u
     }
     // 设置线程状态为就绪状态
     thread->status = THREAD_READY;
-    // 初始化线程的时间片计数为 0
+    // 设置线程的优先级，超出范围的优先级按最高优先级处理
+    thread->priority = min(priority, THREAD_PRIORITY_MAX);
+    thread->dynamicPriority = thread->priority;
+    // 默认使用公平调度，虚拟运行时间在加入调度器时对齐到当前的最小值
+    thread->policy = THREAD_POLICY_FAIR;
+    thread->vruntime = 0;
+    // 线程第一次进入就绪队列时填充时间片
     thread->ticks = 0;
-    // 设置线程的优先级
-    thread->priority = priority;
     // 初始化用户栈索引为 -1
     thread->userStackIndex = -1;
-    // 为线程分配内核栈内存，并按页对齐
-    uint32 kernelStack = (uint32)kmalloc(KERNEL_STACK_SIZE, PAGE_ALIGNED);
-    // 打印内核栈的地址
-    monitor_Printf("kernelStack: kernelStack = %x\n", kernelStack);
-    // 映射内核栈的每一页内存
-    for (int32 i = 0; i < KERNEL_STACK_SIZE / PAGE_SIZE; i++)
+    // 从内核栈缓存中取出一个已经映射好的栈，栈下方是不映射的保护页
+    uint32 kernelStack = kstack_Alloc();
+    if (kernelStack == 0)
     {
-        // 映射内核栈的每一页到物理内存
-        map_Page(kernelStack + i * PAGE_SIZE, -1);
+        if (allocated)
+        {
+            kmem_Cache_Free(tcbCache, thread);
+        }
+        return nullptr;
     }
-    // 将分配的内核栈内存初始化为 0
-    memset((void*)kernelStack, 0, KERNEL_STACK_SIZE);
     // 记录线程的内核栈地址
     thread->kernelStack = kernelStack;
-    // 计算线程的内核栈指针，预留切换栈和中断栈的空间
-    thread->kernelEsp = kernelStack + KERNEL_STACK_SIZE - (sizeof(interrupt_stack_t)) + (sizeof(switch_stack_t));
+    // 计算线程的内核栈指针，在栈顶依次预留中断栈和切换栈的空间
+    thread->kernelEsp = kernelStack + KERNEL_STACK_SIZE - sizeof(interrupt_stack_t) - sizeof(switch_stack_t);
+    // 只清零栈顶的切换栈和中断栈，栈的其余部分在使用前总会被写入，无需清零
+    memset((void*)thread->kernelEsp, 0, sizeof(interrupt_stack_t) + sizeof(switch_stack_t));
     // 获取切换栈的指针
     switch_stack_t* switchStack = (switch_stack_t*)(thread->kernelEsp);
     // 初始化切换栈的寄存器值为 0
@@ -252,6 +276,7 @@ void thread_Test(void)
 
 void destroy_Thread(tcb_t* thread)
 {
-    kfree((void*)thread->kernelStack);
-    kfree(thread);
+    process_Remove_Thread(thread);
+    kstack_Free(thread->kernelStack);
+    kmem_Cache_Free(tcbCache, thread);
 }
\ No newline at end of file
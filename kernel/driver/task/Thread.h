@@ -36,9 +36,20 @@
 #include "Interrupt.h"
 #include "Linked_List.h"
 
+// 线程优先级分为 THREAD_PRIORITY_LEVELS 级，数值越大优先级越高。
+// 实时线程每一级对应一个就绪队列；公平调度的线程按优先级决定权重，即 CPU 份额
+#define THREAD_PRIORITY_LEVELS   32
+#define THREAD_PRIORITY_MAX      (THREAD_PRIORITY_LEVELS - 1)
 #define THREAD_DEFAULT_PRIORITY  10
+// 实时线程的时间片长度（时钟中断数）等于其基础优先级，但不少于 THREAD_TIME_SLICE_MIN
+#define THREAD_TIME_SLICE_MIN    2
 
-#define KERNEL_STACK_SIZE  8192
+// 调度类：线程默认按虚拟运行时间公平调度；实时线程按优先级调度，总是先于公平调度的线程运行
+#define THREAD_POLICY_FAIR       0
+#define THREAD_POLICY_RT         1
+
+// 每个线程的内核栈大小，栈下方保留一个不映射的保护页，见 Kstack.h
+#define KERNEL_STACK_SIZE  32768
 
 #define EFLAGS_MBS    (1 << 1)
 #define EFLAGS_IF_0   (0 << 9)
@@ -78,16 +89,26 @@ struct thread_struct
     // 方便在调试或日志记录时识别不同的线程。
     char name[32];
 
-    // 线程的优先级，范围是 0 - 255。
-    // 操作系统在进行任务调度时，会参考这个优先级来决定线程的执行顺序。
+    // 线程的基础优先级，范围是 0 - THREAD_PRIORITY_MAX。
+    // 实时线程按优先级调度，公平调度的线程按优先级决定权重。
     uint8 priority;
 
+    // 线程的调度类，THREAD_POLICY_FAIR 或 THREAD_POLICY_RT。
+    uint8 policy;
+
+    // 线程的动态优先级，决定线程在哪一级就绪队列中。
+    // 线程等待过久时被逐级提升，避免饥饿；被选中运行时恢复为基础优先级。
+    uint8 dynamicPriority;
+
+    // 线程进入就绪队列或上一次被提升优先级时的调度时钟数，用于判断线程是否等待过久。
+    uint32 readyTick;
+
     // 线程的状态，使用前面定义的 task_status 枚举类型。
     // 可能的状态包括运行中、就绪、阻塞、等待、挂起和死亡等。
     enum thread_status status;
 
-    // 线程的时间片计数，代表线程在 CPU 上可以执行的时间片数量。
-    // 当这个值减为 0 时，操作系统可能会进行任务调度，切换到其他线程执行。
+    // 线程剩余的时间片，每次时钟中断减一。
+    // 当这个值减为 0 时，线程被放到同一优先级就绪队列的尾部，重新填充时间片。
     uint32 ticks;
 
     // 用户栈的基地址，指向线程在用户模式下的栈起始位置。
@@ -105,6 +126,16 @@ struct thread_struct
     // 抢占计数器，用于控制内核抢占。
     // 当该值大于 0 时，内核抢占被禁止，线程不会被其他线程抢占执行。
     uint32 preemptCount;
+
+    // 线程所属的进程，同一进程的线程共享地址空间。
+    // 切换到其他进程的线程时需要切换页目录。
+    struct process_struct* process;
+
+    // 按权重折算的虚拟运行时间（TSC 周期数），公平调度总是选择该值最小的线程。
+    uint64 vruntime;
+
+    // 线程本次开始运行或上一次统计运行时间时的 TSC 值。
+    uint64 execStart;
 };
 typedef struct thread_struct tcb_t;
 
@@ -153,6 +184,7 @@ struct switch_stack
 typedef struct switch_stack switch_stack_t;
 
 
+void thread_Cache_Init(void);
 tcb_t* thread_Init(tcb_t* thread, char* name, void* function, uint32 priority, uint8 user);
 void destroy_Thread(tcb_t* thread);
 void thread_Test(void);
@@ -28,52 +28,512 @@
 ******************************************************************************/
 
 #include "Timer.h"
+#include "Cond_Var.h"
+
+extern uint32 get_Eflags();
+extern void set_Eflags(uint32 eflags);
 
 static uint32 tick = 0;
+static uint32 tickFrequency = TIMER_FREQUENCY;
+static uint32 pitDivisor;
+// 时钟中断源为本地 APIC 定时器时 apicTick 为 true，tickPeriod 为每个时钟中断的计数值
+static bool apicTick = false;
+static uint32 tickPeriod;
+// 校准得到的 TSC 和 APIC 定时器的频率，clockMult 为 TSC 周期到纳秒的定点换算系数
+static uint32 tscKhz = 0;
+static uint32 apicKhz = 0;
+static uint32 clockMult = 0;
+static uint64 clockTscBase;
+// 空闲时时钟中断源工作在单次计数模式，nohzCount 为本次编程的计数值，
+// 计数总是在时钟中断的边界上结束，结束时共经过 nohzTicks 个时钟中断
+static bool nohzActive = false;
+static uint32 nohzCount;
+static uint32 nohzTicks;
+// 时间轮，wheelTick 为时间轮下一个要处理的时钟中断，不超过 tick 时在时钟中断中追上
+static doubly_linked_list_t timerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static uint32 wheelTick = 1;
+
+/**
+ * @brief 将 PIT 通道 0 设置为周期模式（模式 2，频率发生器）。
+ *
+ * 模式 2 每个周期从 pitDivisor 递减一次，读出的计数值就是距下一个时钟中断的剩余计数；
+ * 模式 3 每个周期递减两遍，无法从计数值得知当前时钟中断走了多少。
+ */
+static void pit_Set_Periodic(void)
+{
+    // 0x34 表示选择计数器 0，先读写低字节再读写高字节，模式 2（频率发生器），二进制计数
+    io_Out_Byte(0x43, 0x34);
+    io_Out_Byte(0x40, (uint8)(pitDivisor & 0xFF));
+    io_Out_Byte(0x40, (uint8)((pitDivisor >> 8) & 0xFF));
+}
+
+/**
+ * @brief 将 PIT 通道 0 设置为单次计数模式（模式 0），计数到 0 时触发一次中断后停止。
+ */
+static void pit_Set_One_Shot(uint32 count)
+{
+    // 0x30 表示选择计数器 0，先读写低字节再读写高字节，模式 0（计数结束时中断），二进制计数
+    io_Out_Byte(0x43, 0x30);
+    io_Out_Byte(0x40, (uint8)(count & 0xFF));
+    io_Out_Byte(0x40, (uint8)((count >> 8) & 0xFF));
+}
+
+/**
+ * @brief 锁存并读取 PIT 通道 0 的当前计数值。
+ */
+static uint32 pit_Read_Count(void)
+{
+    uint8 low;
+    uint8 high;
+    io_Out_Byte(0x43, 0x00);
+    io_In_Byte(0x40, &low);
+    io_In_Byte(0x40, &high);
+    return ((uint32)high << 8) | low;
+}
+
+static void timer_Source_Periodic(void)
+{
+    if (apicTick)
+    {
+        apic_Timer_Periodic(tickPeriod);
+    }
+    else
+    {
+        pit_Set_Periodic();
+    }
+}
+
+static void timer_Source_One_Shot(uint32 count)
+{
+    if (apicTick)
+    {
+        apic_Timer_One_Shot(count);
+    }
+    else
+    {
+        pit_Set_One_Shot(count);
+    }
+}
+
+static uint32 timer_Source_Count(void)
+{
+    return apicTick ? apic_Timer_Current() : pit_Read_Count();
+}
+
+/**
+ * @brief 以 PIT 通道 2 为基准，测量 TSC 和 APIC 定时器的频率。
+ *
+ * 通道 2 的门控由端口 0x61 控制且不产生中断，以模式 0 计数 TIMER_CALIBRATE_MS 毫秒，
+ * 计数结束时端口 0x61 的第 5 位置位，轮询期间读取 TSC 和 APIC 定时器的计数差。
+ * 调用者需关中断，结果保存在 tscKhz 和 apicKhz 中，失败时保持为 0。
+ */
+static void timer_Calibrate(void)
+{
+    uint8 gate;
+    uint8 status;
+    uint32 loops = 0;
+    // 没有 TSC 时执行 rdtsc 会触发 #UD，只校准 APIC 定时器
+    bool tsc = cpu_Has_Feature(CPUID_FEATURE_TSC);
+    io_In_Byte(0x61, &gate);
+    // 打开通道 2 的门控，关闭扬声器输出
+    io_Out_Byte(0x61, (gate & ~0x02) | 0x01);
+    // 0xB0 表示选择计数器 2，先读写低字节再读写高字节，模式 0（计数结束时输出高电平），二进制计数
+    io_Out_Byte(0x43, 0xB0);
+    uint32 latch = PIT_FREQUENCY / 1000 * TIMER_CALIBRATE_MS;
+    io_Out_Byte(0x42, (uint8)(latch & 0xFF));
+    io_Out_Byte(0x42, (uint8)((latch >> 8) & 0xFF));
+    if (apic_Enabled())
+    {
+        // APIC 定时器被屏蔽，从最大值开始单次计数
+        apic_Write(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_INT_NUM);
+        apic_Write(APIC_REG_TIMER_INIT, 0xFFFFFFFF);
+    }
+    uint64 tscStart = tsc ? cpu_Read_Tsc() : 0;
+    do
+    {
+        io_In_Byte(0x61, &status);
+        loops++;
+    } while ((status & 0x20) == 0 && loops < TIMER_CALIBRATE_LOOPS);
+    uint64 tscEnd = tsc ? cpu_Read_Tsc() : 0;
+    uint32 apicCount = apic_Enabled() ? 0xFFFFFFFF - apic_Timer_Current() : 0;
+    io_Out_Byte(0x61, gate);
+    if ((status & 0x20) == 0)
+    {
+        monitor_Printf("timer: PIT calibration timed out\n");
+        return;
+    }
+    if (tsc)
+    {
+        tscKhz = (uint32)(tscEnd - tscStart) / TIMER_CALIBRATE_MS;
+    }
+    apicKhz = apicCount / TIMER_CALIBRATE_MS;
+}
+
+/**
+ * @brief 将定时器挂到时间轮上，调用者需关中断。
+ *
+ * 按到期时刻与 wheelTick 的距离选择层：距离小于 2^(6(L+1)) 的放在第 L 层，
+ * 槽位由到期时刻在该层对应的 6 位决定，插入为 O(1)。已经到期的定时器放在下一个要处理的槽位，
+ * 超出时间轮范围的定时器暂时放在最高层最远的槽位，级联时重新计算位置。
+ */
+static void timer_Wheel_Insert(kernel_timer_t* timer)
+{
+    uint32 expires = timer->expires;
+    uint32 delta = expires - wheelTick;
+    if ((int32)delta < 0)
+    {
+        expires = wheelTick;
+        delta = 0;
+    }
+    uint32 level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << (TIMER_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    if (delta >= (1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+    {
+        expires = wheelTick + (1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+    timer->slot = &timerWheel[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    timer->node.dataPtr = timer;
+    doubly_Linked_List_Append(timer->slot, &timer->node);
+}
+
+/**
+ * @brief 将高层的一个槽位中的定时器重新插入时间轮，它们会落到更低的层。
+ */
+static void timer_Wheel_Cascade(uint32 level)
+{
+    doubly_linked_list_t* slot = &timerWheel[level][(wheelTick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+    while (slot->size > 0)
+    {
+        kernel_timer_t* timer = (kernel_timer_t*)slot->head->dataPtr;
+        doubly_Linked_List_Remove(slot, &timer->node);
+        timer_Wheel_Insert(timer);
+    }
+}
+
+/**
+ * @brief 推进时间轮直到追上 tick，依次执行到期的定时器。
+ *
+ * 每处理一个时钟中断，低 6L 位全为 0 时先把第 L 层的当前槽位级联到低层，
+ * 再执行第 0 层当前槽位中的全部定时器。回调中可以重新添加定时器。
+ */
+static void timer_Wheel_Run(void)
+{
+    while ((int32)(tick - wheelTick) >= 0)
+    {
+        for (uint32 level = 1; level < TIMER_WHEEL_LEVELS; level++)
+        {
+            if ((wheelTick & ((1u << (TIMER_WHEEL_BITS * level)) - 1)) != 0)
+            {
+                break;
+            }
+            timer_Wheel_Cascade(level);
+        }
+        doubly_linked_list_t* slot = &timerWheel[0][wheelTick & TIMER_WHEEL_MASK];
+        while (slot->size > 0)
+        {
+            kernel_timer_t* timer = (kernel_timer_t*)slot->head->dataPtr;
+            doubly_Linked_List_Remove(slot, &timer->node);
+            timer->slot = nullptr;
+            timer->callback(timer->data);
+        }
+        wheelTick++;
+    }
+}
+
+/**
+ * @brief 距下一个定时事件的时钟中断数，空闲时时钟最多停止这么久。
+ *
+ * 只查看第 0 层的槽位，遇到需要级联的时钟中断时停止，因为高层的定时器可能在那时落入第 0 层。
+ * 同时受时钟中断源单次计数的最大值限制，PIT 为 16 位，APIC 定时器为 32 位。
+ */
+static uint32 timer_Next_Deadline(void)
+{
+    uint32 maxTicks = (apicTick ? 0xFFFFFFFF : 0xFFFF) / tickPeriod;
+    for (uint32 ticks = 1; ticks < maxTicks; ticks++)
+    {
+        uint32 index = (tick + ticks) & TIMER_WHEEL_MASK;
+        if (index == 0 || timerWheel[0][index].size > 0)
+        {
+            return ticks;
+        }
+    }
+    return maxTicks;
+}
 
 static void timer_Handler(isr_params_t params)
 {
-    tcb_t* currentThread = get_Current_Thread();
-    currentThread->ticks++;
-    if (currentThread->ticks >= currentThread->priority)
+    if (nohzActive)
     {
-        currentThread->needReSchedule = true;
+        // 单次计数结束，补上空闲期间跳过的时钟中断，恢复周期模式
+        nohzActive = false;
+        tick += nohzTicks;
+        timer_Source_Periodic();
     }
-    // monitor_Printf("tick = %d\n", tick++);
+    else
+    {
+        tick++;
+    }
+    timer_Wheel_Run();
+    schedule_Tick();
+}
+
+uint32 timer_Ticks(void)
+{
+    return tick;
+}
+
+/**
+ * @brief 将毫秒数向上取整换算为时钟中断数。
+ */
+uint32 timer_Ms_To_Ticks(uint32 ms)
+{
+    // 先按整秒换算，避免 ms * tickFrequency 溢出
+    return (ms / 1000) * tickFrequency + ((ms % 1000) * tickFrequency + 999) / 1000;
+}
+
+/**
+ * @brief 自时钟初始化以来经过的纳秒数，单调递增。
+ *
+ * 由 TSC 按校准得到的频率换算，ns = (cycles * clockMult) >> CLOCK_SHIFT，
+ * 64 位周期数拆成高低两个 32 位分别相乘，避免 64 位乘法溢出。TSC 不可用时退化为时钟中断的精度。
+ *
+ * @return uint64 纳秒数。
+ */
+uint64 clock_Monotonic_Ns(void)
+{
+    if (clockMult == 0)
+    {
+        return (uint64)tick * (1000000000 / tickFrequency);
+    }
+    uint64 cycles = cpu_Read_Tsc() - clockTscBase;
+    uint64 high = (uint64)(uint32)(cycles >> 32) * clockMult;
+    uint64 low = (uint64)(uint32)cycles * clockMult;
+    return (high << (32 - CLOCK_SHIFT)) + (low >> CLOCK_SHIFT);
 }
 
 /**
- * @brief 初始化可编程间隔定时器（PIT），设置定时器中断频率。
+ * @brief 校准得到的 TSC 频率（kHz），未校准时返回 0。
+ */
+uint32 clock_Tsc_Khz(void)
+{
+    return tscKhz;
+}
+
+/**
+ * @brief 添加一个定时器，在 timer_Ticks() 到达 expires 时于时钟中断中调用 callback(data)。
+ *
+ * 定时器不能处于挂起状态，重新设置到期时刻前需先调用 timer_Cancel。
+ * expires 不晚于当前时刻时在下一个时钟中断执行。
+ * 空闲时钟停止期间添加的定时器会先恢复周期时钟，保证不会错过到期时刻。
+ *
+ * @param timer 定时器，在执行或取消前必须保持有效。
+ * @param callback 到期时调用的函数，在中断上下文中执行，不能阻塞。
+ * @param data 传给回调函数的参数。
+ * @param expires 到期时刻，以 timer_Ticks() 的绝对值表示。
+ */
+void timer_Add(kernel_timer_t* timer, timer_callback_t callback, void* data, uint32 expires)
+{
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    timer_Nohz_Exit();
+    timer->callback = callback;
+    timer->data = data;
+    timer->expires = expires;
+    timer_Wheel_Insert(timer);
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 取消一个定时器，直接从所在槽位的链表中摘除，为 O(1) 操作。
+ *
+ * @return bool 定时器取消前是否处于挂起状态，为 false 表示已经执行过或从未添加。
+ */
+bool timer_Cancel(kernel_timer_t* timer)
+{
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    bool pending = timer_Pending(timer);
+    if (pending)
+    {
+        doubly_Linked_List_Remove(timer->slot, &timer->node);
+        timer->slot = nullptr;
+    }
+    set_Eflags(eflags);
+    return pending;
+}
+
+bool timer_Pending(kernel_timer_t* timer)
+{
+    return timer->slot != nullptr;
+}
+
+/**
+ * @brief 空闲线程准备停机时停止周期时钟，调用者需关中断。
+ *
+ * 按距下一个定时事件的时长将时钟中断源编程为单次计数，CPU 在此期间只被其他中断唤醒。
+ * PIT 的计数值只有 16 位，在 TIMER_FREQUENCY 为 50Hz 时最多停止约 54ms；
+ * APIC 定时器的计数值为 32 位，最多停止到下一个定时器或时间轮级联的时刻。
+ *
+ * 单次计数包含当前时钟中断剩余的计数，因此总是在时钟中断的边界上结束，
+ * 时钟中断的相位在空闲前后保持不变。
+ *
+ * @return bool 是否停止了周期时钟，时长太短时不停止。
+ */
+bool timer_Nohz_Enter(void)
+{
+    uint32 ticks = timer_Next_Deadline();
+    if (nohzActive || ticks < TIMER_NOHZ_MIN_TICKS)
+    {
+        return false;
+    }
+    uint32 current = min(timer_Source_Count(), tickPeriod);
+    nohzCount = (current > 0 ? current : tickPeriod) + (ticks - 1) * tickPeriod;
+    nohzTicks = ticks;
+    nohzActive = true;
+    timer_Source_One_Shot(nohzCount);
+    return true;
+}
+
+/**
+ * @brief 恢复周期时钟。
+ *
+ * CPU 被其他中断提前唤醒、有线程变为就绪时调用，根据剩余的计数补上已经过去的时钟中断。
+ * 当前时钟中断只走了一部分时，先用单次计数走完剩下的部分，由该次时钟中断恢复周期模式，
+ * 不足一个时钟中断的时间不会丢失，时钟中断计数不会随空闲次数漂移。
+ * 单次计数已经结束时由时钟中断恢复，这里什么也不做。
+ */
+void timer_Nohz_Exit(void)
+{
+    uint32 eflags = get_Eflags();
+    disable_Interrupt();
+    uint32 remaining = nohzActive ? min(timer_Source_Count(), nohzCount) : 0;
+    if (remaining > 0)
+    {
+        // 计数在时钟中断的边界上结束，剩余计数中整数个时钟中断之外的部分属于当前时钟中断
+        uint32 partial = remaining % tickPeriod;
+        uint32 pending = remaining / tickPeriod + (partial > 0 ? 1 : 0);
+        tick += nohzTicks - pending;
+        if (partial > 0)
+        {
+            nohzCount = partial;
+            nohzTicks = 1;
+            timer_Source_One_Shot(partial);
+        }
+        else
+        {
+            nohzActive = false;
+            timer_Source_Periodic();
+        }
+    }
+    set_Eflags(eflags);
+}
+
+/**
+ * @brief 初始化时钟中断源，设置定时器中断频率。
  * 
- * 此函数通过计算除数并向 PIT 的控制寄存器和数据端口写入相应的值，
- * 来设置定时器的中断频率，同时注册定时器中断的回调函数。
+ * 开启本地 APIC，并以 PIT 为基准校准 TSC 和 APIC 定时器。APIC 定时器可用时作为时钟中断源，
+ * 同时在 8259A 上屏蔽 PIT 所在的 IRQ0；否则仍通过计算除数并向 PIT 的控制寄存器和数据端口
+ * 写入相应的值来设置定时器的中断频率。TSC 校准成功后 clock_Monotonic_Ns 使用 TSC 计时。
+ * 必须在分页初始化之后、开中断之前调用。
  * 
  * @param frequency 期望的定时器中断频率，单位为赫兹（Hz）。
  */
 void timer_Init(uint32 frequency)
 {
-    // 计算 PIT 的除数，1193180 是 PIT 的时钟频率（Hz）
-    // 除数 = 时钟频率 / 期望的中断频率
-    uint32 divisor = 1193180 / frequency;
-    
-    // 提取除数的低 8 位
-    uint8 low = (uint8)(divisor & 0xFF);
-    
-    // 提取除数的高 8 位
-    uint8 high = (uint8)((divisor >> 8) & 0xFF);
+    tickFrequency = frequency;
+    // 计算 PIT 的除数，除数 = 时钟频率 / 期望的中断频率
+    pitDivisor = PIT_FREQUENCY / frequency;
+    tickPeriod = pitDivisor;
     
     // 注册定时器中断（IRQ0）的处理回调函数
     // IRQ0_INT_NUM 是定时器中断对应的中断号
     // timer_Handler 是中断发生时要调用的回调函数
     register_Interrupt_Handler(IRQ0_INT_NUM, &timer_Handler);
+
+    for (uint32 level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (uint32 i = 0; i < TIMER_WHEEL_SIZE; i++)
+        {
+            doubly_Linked_List_Init(&timerWheel[level][i]);
+        }
+    }
     
-    // 向 PIT 的控制寄存器（端口 0x43）写入控制字 0x36
-    // 0x36 表示选择计数器 0，先读写低字节再读写高字节，模式 3（方波发生器），二进制计数
-    io_Out_Byte(0x43, 0x36);
-    
-    // 向 PIT 的计数器 0 数据端口（端口 0x40）写入除数的低 8 位
-    io_Out_Byte(0x40, low);
-    
-    // 向 PIT 的计数器 0 数据端口（端口 0x40）写入除数的高 8 位
-    io_Out_Byte(0x40, high);
-}
\ No newline at end of file
+    bool apic = apic_Init();
+    timer_Calibrate();
+    // 换算系数不超过 32 位要求 TSC 频率不低于约 1MHz
+    if (tscKhz >= 1000)
+    {
+        clockMult = div_U64_U32((uint64)1000000 << CLOCK_SHIFT, tscKhz);
+        clockTscBase = cpu_Read_Tsc();
+    }
+    if (apic && apicKhz > 0)
+    {
+        apicTick = true;
+        tickPeriod = apicKhz * 1000 / frequency;
+        register_Interrupt_Handler(APIC_TIMER_INT_NUM, &timer_Handler);
+        // PIT 不再产生时钟中断，在主片 8259A 上屏蔽 IRQ0
+        uint8 mask;
+        io_In_Byte(0x21, &mask);
+        io_Out_Byte(0x21, mask | 0x01);
+    }
+    monitor_Printf("timer: tsc %d kHz, apic %d kHz, tick source %s\n",
+        tscKhz, apicKhz, apicTick ? "apic" : "pit");
+
+    // PIT 时向控制寄存器写入控制字，再依次写入除数的低 8 位和高 8 位
+    timer_Source_Periodic();
+}
+
+static uint32 timerTestFired;
+
+static void timer_Test_Callback(void* data)
+{
+    timerTestFired += (uint32)data;
+}
+
+static bool timer_Test_Never(void)
+{
+    return false;
+}
+
+static void timer_Test_Thread(void)
+{
+    kernel_timer_t timers[3];
+    uint32 start = timer_Ticks();
+    uint64 startNs = clock_Monotonic_Ns();
+    timer_Add(&timers[0], timer_Test_Callback, (void*)1, start + 2);
+    timer_Add(&timers[1], timer_Test_Callback, (void*)10, start + 4);
+    // 超出第 0 层范围的定时器在取消前挂在高层
+    timer_Add(&timers[2], timer_Test_Callback, (void*)100, start + 5000);
+    ASSERT(timer_Cancel(&timers[1]));
+    ASSERT(!timer_Cancel(&timers[1]));
+    thread_Sleep(200);
+    ASSERT(timer_Ticks() - start >= timer_Ms_To_Ticks(200));
+    // 睡眠至少 200ms，TSC 换算的时间与时钟中断计数一致
+    uint64 sleptNs = clock_Monotonic_Ns() - startNs;
+    ASSERT(sleptNs >= 190000000);
+    monitor_Printf("timer_Test slept %d us\n", div_U64_U32(sleptNs, 1000));
+    ASSERT(timerTestFired == 1 && !timer_Pending(&timers[0]));
+    ASSERT(timer_Cancel(&timers[2]));
+
+    cond_var_t condVar;
+    yieldlock_t lock;
+    cond_Var_Init(&condVar);
+    yieldlock_Init(&lock);
+    start = timer_Ticks();
+    ASSERT(!cond_Var_Wait_Timeout(&condVar, &lock, timer_Test_Never, 100));
+    ASSERT(timer_Ticks() - start >= timer_Ms_To_Ticks(100));
+    ASSERT(condVar.waitingThreadQueue.size == 0);
+    yieldlock_Lock(&lock);
+    ASSERT(!yieldlock_Lock_Timeout(&lock, 40));
+    yieldlock_Unlock(&lock);
+    monitor_Printf("timer_Test passed, %d ticks\n", timer_Ticks());
+}
+
+void timer_Test(void)
+{
+    tcb_t* testThread = thread_Init(nullptr, "timerTest", timer_Test_Thread, THREAD_DEFAULT_PRIORITY, false);
+    add_Thread_To_Schedule(testThread);
+}
@@ -33,9 +33,54 @@
 #include "Monitor.h"
 #include "Thread.h"
 #include "Scheduler.h"
+#include "Apic.h"
+#include "Cpu.h"
+#include "Math.h"
 
 #define TIMER_FREQUENCY 50
+// PIT 的输入时钟频率（Hz）
+#define PIT_FREQUENCY   1193180
+// 空闲时停止周期时钟的最短时长（时钟中断数），更短时重新编程 PIT 的开销不值得
+#define TIMER_NOHZ_MIN_TICKS  2
+// 启动时以 PIT 通道 2 校准 TSC 和 APIC 定时器的时长（ms），以及轮询次数的上限
+#define TIMER_CALIBRATE_MS    10
+#define TIMER_CALIBRATE_LOOPS 1000000
+// TSC 周期数到纳秒的定点换算的小数位数
+#define CLOCK_SHIFT           22
+
+// 分层时间轮：每层 2^TIMER_WHEEL_BITS 个槽位，共 TIMER_WHEEL_LEVELS 层，
+// 覆盖 2^24 个时钟中断（50Hz 时约 93 小时），更远的定时器在最高层反复级联直到进入范围
+#define TIMER_WHEEL_BITS      6
+#define TIMER_WHEEL_SIZE      (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK      (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS    4
+
+typedef void (*timer_callback_t)(void* data);
+
+/**
+ * @struct kernel_timer
+ * @brief 挂在时间轮上的定时器，通常嵌入在调用者的数据结构或栈上，不需要分配内存。
+ */
+struct kernel_timer
+{
+    doubly_linked_list_node_t node;     /**< 挂在时间轮槽位链表上，dataPtr 指向定时器自身。 */
+    doubly_linked_list_t *slot;         /**< 所在的槽位，未挂起时为 nullptr。 */
+    uint32 expires;                     /**< 到期时刻，以 timer_Ticks() 的绝对值表示。 */
+    timer_callback_t callback;          /**< 到期时在时钟中断中关中断调用，不能阻塞。 */
+    void *data;                         /**< 传给回调函数的参数。 */
+};
+typedef struct kernel_timer kernel_timer_t;
 
 void timer_Init(uint32 frequency);
+uint32 timer_Ticks(void);
+uint32 timer_Ms_To_Ticks(uint32 ms);
+uint64 clock_Monotonic_Ns(void);
+uint32 clock_Tsc_Khz(void);
+void timer_Add(kernel_timer_t* timer, timer_callback_t callback, void* data, uint32 expires);
+bool timer_Cancel(kernel_timer_t* timer);
+bool timer_Pending(kernel_timer_t* timer);
+bool timer_Nohz_Enter(void);
+void timer_Nohz_Exit(void);
+void timer_Test(void);
 
 #endif // !TIMER_H
@@ -35,6 +35,7 @@
 #include "Page_Table.h"
 #include "Linked_List.h"
 #include "Scheduler.h"
+#include "Process.h"
 
 char* helloWorld = "Hello World!\n";
 static void system_Init()
@@ -44,9 +45,16 @@ static void system_Init()
     monitor_Printf(helloWorld);
     gdt_Init();
     idt_Init();
+    cpu_Enable_Sse2();
     page_Table_Init();
     kheap_Init();
+    process_Init();
     timer_Init(TIMER_FREQUENCY);
+    // schedule_Init 切换到主线程后不再返回，启动时的堆统计必须在它之前打印
+    if (KHEAP_STATS_ON_BOOT)
+    {
+        kheap_Stats_Dump();
+    }
     schedule_Init();
 } 
 
@@ -55,8 +63,17 @@ int main(void)
     system_Init();
     // thread_Test();
     // ordered_Array_Test();
+    // bitmap_Test();
+    // buddy_Test();
     // page_Table_Test();
+    // page_Switch_Benchmark(64);
     // kheap_Test();
+    // kmem_Cache_Test();
+    // kstack_Test();
+    // vmalloc_Test();
+    // process_Test();
+    // timer_Test();
+    // page_Zero_Pool_Dump();
     // doubly_Linked_Test();
     // while(1);
     return 0;
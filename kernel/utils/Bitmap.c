@@ -28,19 +28,51 @@
 ******************************************************************************/
 
 #include "Bitmap.h"
+#include "Math.h"
+#include "Debug.h"
 
-bitmap_t bitmap_Create(uint32* array, int numBits)
+#define BITMAP_FULL_WORD 0xFFFFFFFF
+
+bitmap_t bitmap_Create(uint32* array, uint32 numBits)
 {
     bitmap_t bitmap;
     bitmap_Init(&bitmap, array, numBits);
     return bitmap;
 }
 
+/**
+ * @brief 计算从 offset 开始、长度为 count 的位掩码，offset + count 不超过 32。
+ */
+static uint32 bit_Mask(uint32 offset, uint32 count)
+{
+    uint32 mask = (count >= 32) ? BITMAP_FULL_WORD : ((1u << count) - 1);
+    return mask << offset;
+}
+
+/**
+ * @brief 根据 array[index] 是否全满更新摘要位图中对应的位。
+ */
+static void summary_Update(bitmap_t* bitmap, uint32 index)
+{
+    if (bitmap->summary == nullptr)
+    {
+        return;
+    }
+    if (bitmap->array[index] == BITMAP_FULL_WORD)
+    {
+        bitmap->summary[INDEX_FROM_BIT(index)] |= (1u << OFFSET_FROM_BIT(index));
+    }
+    else
+    {
+        bitmap->summary[INDEX_FROM_BIT(index)] &= ~(1u << OFFSET_FROM_BIT(index));
+    }
+}
+
 // 位图初始化函数
 void bitmap_Init(bitmap_t* bitmap, uint32* array, uint32 numBits)
 {
     bitmap->bits = numBits;
-    bitmap->arraySize = numBits / 32;
+    bitmap->arraySize = (numBits + 31) / 32;
     if (array == nullptr)
     {
         array = (uint32*)kmalloc(bitmap->arraySize * sizeof(uint32), NOT_PAGE_ALIGNED);
@@ -50,39 +82,181 @@ void bitmap_Init(bitmap_t* bitmap, uint32* array, uint32 numBits)
     {
         bitmap->allocArray = false;
     }
-    for (int32 i = 0; i < bitmap->arraySize; i++)
+    for (uint32 i = 0; i < bitmap->arraySize; i++)
     {
         array[i] = 0;
     }
+    // 最后一个字中超出 numBits 的位永远标记为已占用，查找时无需再做边界判断
+    if (OFFSET_FROM_BIT(numBits) != 0)
+    {
+        array[bitmap->arraySize - 1] = ~bit_Mask(0, OFFSET_FROM_BIT(numBits));
+    }
     bitmap->array = array;
+    bitmap->hint = 0;
+    bitmap->summary = nullptr;
+    bitmap->allocSummary = false;
+}
+
+/**
+ * @brief 为位图挂载两级摘要位图。
+ *
+ * 摘要位图的第 i 位表示 array[i] 是否已经全满，查找空闲位时先在摘要位图上用 bsf
+ * 找到第一个未满的字，再在该字上用 bsf 找到空闲位。8192 位的位图只需要 8 个摘要字。
+ *
+ * @param bitmap 指向位图结构体的指针。
+ * @param summary 摘要位图的存储空间，至少 (arraySize + 31) / 32 个字，为 nullptr 时动态分配。
+ * @return bool 动态分配失败时返回 false。
+ */
+bool bitmap_Attach_Summary(bitmap_t* bitmap, uint32* summary)
+{
+    uint32 summarySize = (bitmap->arraySize + 31) / 32;
+    bitmap->allocSummary = false;
+    if (summary == nullptr)
+    {
+        summary = (uint32*)kmalloc(summarySize * sizeof(uint32), NOT_PAGE_ALIGNED);
+        if (summary == nullptr)
+        {
+            return false;
+        }
+        bitmap->allocSummary = true;
+    }
+    // 摘要位图末尾多余的位标记为全满，避免查找到不存在的字
+    for (uint32 i = 0; i < summarySize; i++)
+    {
+        summary[i] = 0;
+    }
+    if (OFFSET_FROM_BIT(bitmap->arraySize) != 0)
+    {
+        summary[summarySize - 1] = ~bit_Mask(0, OFFSET_FROM_BIT(bitmap->arraySize));
+    }
+    bitmap->summary = summary;
+    for (uint32 i = 0; i < bitmap->arraySize; i++)
+    {
+        summary_Update(bitmap, i);
+    }
+    return true;
 }
 
 void bitmap_Set_Bit(bitmap_t* bitmap, uint32 bit)
 {
     uint32 arrayIndex = INDEX_FROM_BIT(bit);
     uint32 offset = OFFSET_FROM_BIT(bit);
-    bitmap->array[arrayIndex] |= (1 << offset);
+    bitmap->array[arrayIndex] |= (1u << offset);
+    summary_Update(bitmap, arrayIndex);
 }
 
 void bitmap_Clear_Bit(bitmap_t* bitmap, uint32 bit)
 {
     uint32 arrayIndex = INDEX_FROM_BIT(bit);
     uint32 offset = OFFSET_FROM_BIT(bit);
-    bitmap->array[arrayIndex] &= ~(1 << offset);
+    bitmap->array[arrayIndex] &= ~(1u << offset);
+    summary_Update(bitmap, arrayIndex);
 }
 
 bool bitmap_Get_Bit(bitmap_t* bitmap, uint32 bit)
 {
     uint32 arrayIndex = INDEX_FROM_BIT(bit);
     uint32 offset = OFFSET_FROM_BIT(bit);
-    return (bitmap->array[arrayIndex] & (1 << offset)) != 0;
+    return (bitmap->array[arrayIndex] & (1u << offset)) != 0;
+}
+
+/**
+ * @brief 将从 bit 开始的 count 个位全部置 1，每次处理一个字。
+ */
+void bitmap_Set_Range(bitmap_t* bitmap, uint32 bit, uint32 count)
+{
+    while (count > 0)
+    {
+        uint32 arrayIndex = INDEX_FROM_BIT(bit);
+        uint32 offset = OFFSET_FROM_BIT(bit);
+        uint32 num = min(count, 32 - offset);
+        bitmap->array[arrayIndex] |= bit_Mask(offset, num);
+        summary_Update(bitmap, arrayIndex);
+        bit += num;
+        count -= num;
+    }
+}
+
+/**
+ * @brief 将从 bit 开始的 count 个位全部清 0，每次处理一个字。
+ */
+void bitmap_Clear_Range(bitmap_t* bitmap, uint32 bit, uint32 count)
+{
+    while (count > 0)
+    {
+        uint32 arrayIndex = INDEX_FROM_BIT(bit);
+        uint32 offset = OFFSET_FROM_BIT(bit);
+        uint32 num = min(count, 32 - offset);
+        bitmap->array[arrayIndex] &= ~bit_Mask(offset, num);
+        summary_Update(bitmap, arrayIndex);
+        bit += num;
+        count -= num;
+    }
+}
+
+/**
+ * @brief 在 [startIndex, endIndex) 范围内查找第一个未满的字。
+ *
+ * 挂载了摘要位图时，每次用 bsf 检查 32 个字；否则逐字跳过全满的字。
+ *
+ * @return uint32 未满字的下标，未找到时返回 endIndex。
+ */
+static uint32 find_Non_Full_Word(bitmap_t* bitmap, uint32 startIndex, uint32 endIndex)
+{
+    // startIndex 可能等于 arraySize，此时不能再读取对应的摘要字
+    if (startIndex >= endIndex)
+    {
+        return endIndex;
+    }
+    if (bitmap->summary == nullptr)
+    {
+        for (uint32 i = startIndex; i < endIndex; i++)
+        {
+            if (bitmap->array[i] != BITMAP_FULL_WORD)
+            {
+                return i;
+            }
+        }
+        return endIndex;
+    }
+    uint32 summaryIndex = INDEX_FROM_BIT(startIndex);
+    // 第一个摘要字中 startIndex 之前的字视为全满
+    uint32 freeWords = ~bitmap->summary[summaryIndex] & ~bit_Mask(0, OFFSET_FROM_BIT(startIndex));
+    while (summaryIndex * 32 < endIndex)
+    {
+        if (freeWords != 0)
+        {
+            uint32 index = summaryIndex * 32 + bit_Scan_Forward(freeWords);
+            return (index < endIndex) ? index : endIndex;
+        }
+        summaryIndex++;
+        if (summaryIndex * 32 < endIndex)
+        {
+            freeWords = ~bitmap->summary[summaryIndex];
+        }
+    }
+    return endIndex;
+}
+
+/**
+ * @brief 在 [startIndex, endIndex) 范围内的字中查找空闲位。
+ */
+static bool find_Free_Bit_In(bitmap_t* bitmap, uint32 startIndex, uint32 endIndex, uint32* bit)
+{
+    uint32 index = find_Non_Full_Word(bitmap, startIndex, endIndex);
+    if (index >= endIndex)
+    {
+        return false;
+    }
+    *bit = index * 32 + bit_Scan_Forward(~bitmap->array[index]);
+    return true;
 }
 
 /**
  * @brief 查找位图中第一个空闲位（值为 0 的位）。
  *
- * 该函数会遍历位图数组，查找第一个值不为全 1 的元素，
- * 然后在该元素的 32 位中查找第一个值为 0 的位。
+ * 先找到第一个不为全 1 的字，再对该字取反后用 bsf 指令直接得到最低的 0 位，
+ * 挂载了摘要位图时查找未满的字也只需要几次 bsf。
  * 如果找到，将该位的索引存储在传入的指针所指向的位置，并返回 true；
  * 如果未找到，返回 false。
  *
@@ -92,36 +266,34 @@ bool bitmap_Get_Bit(bitmap_t* bitmap, uint32 bit)
  */
 bool bitmap_Find_First_Free_Bit(bitmap_t* bitmap, uint32* bit)
 {
-    // 遍历位图数组中的每个元素
-    for (uint32 i = 0; i < bitmap->arraySize; i++)
+    return find_Free_Bit_In(bitmap, 0, bitmap->arraySize, bit);
+}
+
+/**
+ * @brief 从上次分配的位置开始查找空闲位（next-fit）。
+ *
+ * 从游标所在的字查找到位图末尾，未找到时再回绕到位图开头，
+ * 避免每次都从头扫描已经分配满的低地址部分。
+ *
+ * @param bitmap 指向位图结构体的指针。
+ * @param bit 用于存储找到的空闲位的索引。
+ * @return bool 若找到空闲位返回 true，否则返回 false。
+ */
+bool bitmap_Find_Next_Free_Bit(bitmap_t* bitmap, uint32* bit)
+{
+    if (find_Free_Bit_In(bitmap, bitmap->hint, bitmap->arraySize, bit) ||
+        find_Free_Bit_In(bitmap, 0, bitmap->hint, bit))
     {
-        // 检查当前元素是否不为全 1（即存在空闲位）
-        if (bitmap->array[i] != 0xFFFFFFFF)
-        {
-            // 遍历当前元素的 32 位
-            for (uint32 j = 0; j < 32; j++)
-            {
-                // 检查当前位是否为 0（空闲位）
-                if (!bitmap_Get_Bit(bitmap, i * 32 + j))
-                {
-                    // 将找到的空闲位的索引存储到传入的指针所指向的位置
-                    *bit = i * 32 + j;
-                    // 找到空闲位，返回 true
-                    return true;
-                }
-            }
-        }
+        bitmap->hint = INDEX_FROM_BIT(*bit);
+        return true;
     }
-    // 未找到空闲位，返回 false
     return false;
 }
 
 void bitmap_Clear(bitmap_t* bitmap)
 {
-    for (uint32 i = 0; i < bitmap->arraySize; i++)
-    {
-        bitmap->array[i] = 0;
-    }
+    bitmap_Clear_Range(bitmap, 0, bitmap->bits);
+    bitmap->hint = 0;
 }
 
 bool bitmap_Allocate_First_Free_Bit(bitmap_t* bitmap, uint32* bit)
@@ -134,12 +306,104 @@ bool bitmap_Allocate_First_Free_Bit(bitmap_t* bitmap, uint32* bit)
     return false;
 }
 
+bool bitmap_Allocate_Next_Free_Bit(bitmap_t* bitmap, uint32* bit)
+{
+    if (bitmap_Find_Next_Free_Bit(bitmap, bit))
+    {
+        bitmap_Set_Bit(bitmap, *bit);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 查找从 bit 开始的第一个值为 1 的位，整字为 0 时直接跳过。
+ *
+ * @return uint32 找到的位的索引，未找到时返回 bits。
+ */
+static uint32 find_Next_Set_Bit(bitmap_t* bitmap, uint32 bit)
+{
+    if (bit >= bitmap->bits)
+    {
+        return bitmap->bits;
+    }
+    uint32 index = INDEX_FROM_BIT(bit);
+    uint32 word = bitmap->array[index] & ~bit_Mask(0, OFFSET_FROM_BIT(bit));
+    while (word == 0)
+    {
+        if (++index >= bitmap->arraySize)
+        {
+            return bitmap->bits;
+        }
+        word = bitmap->array[index];
+    }
+    // 超出 bits 的填充位始终为 1，结果不会越过 bits
+    return min(index * 32 + bit_Scan_Forward(word), bitmap->bits);
+}
+
+/**
+ * @brief 查找从 bit 开始的第一个值为 0 的位，整字为全 1 时直接跳过。
+ *
+ * @return uint32 找到的位的索引，未找到时返回 bits。
+ */
+static uint32 find_Next_Clear_Bit(bitmap_t* bitmap, uint32 bit)
+{
+    if (bit >= bitmap->bits)
+    {
+        return bitmap->bits;
+    }
+    uint32 index = INDEX_FROM_BIT(bit);
+    uint32 word = ~bitmap->array[index] & ~bit_Mask(0, OFFSET_FROM_BIT(bit));
+    if (word != 0)
+    {
+        return index * 32 + bit_Scan_Forward(word);
+    }
+    uint32 bitFound = 0;
+    if (find_Free_Bit_In(bitmap, index + 1, bitmap->arraySize, &bitFound))
+    {
+        return bitFound;
+    }
+    return bitmap->bits;
+}
+
+/**
+ * @brief 分配 count 个连续的空闲位。
+ *
+ * 交替查找下一个 0 位和其后的下一个 1 位得到每段空闲区间，
+ * 整字为全 0 或全 1 时一次跳过 32 位，直到找到长度不小于 count 的区间（first-fit）。
+ *
+ * @param bitmap 指向位图结构体的指针。
+ * @param count 需要的连续位数。
+ * @param bit 用于存储分配到的第一个位的索引。
+ * @return bool 若找到并分配成功返回 true，否则返回 false。
+ */
+bool bitmap_Allocate_Range(bitmap_t* bitmap, uint32 count, uint32* bit)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    uint32 start = find_Next_Clear_Bit(bitmap, 0);
+    while (start + count <= bitmap->bits)
+    {
+        uint32 end = find_Next_Set_Bit(bitmap, start);
+        if (end - start >= count)
+        {
+            bitmap_Set_Range(bitmap, start, count);
+            *bit = start;
+            return true;
+        }
+        start = find_Next_Clear_Bit(bitmap, end);
+    }
+    return false;
+}
+
 /**
  * @brief 扩展位图的大小。
  *
  * 该函数用于扩展位图的大小，会分配新的内存空间来存储扩展后的位图数据，
  * 并将原有的位图数据复制到新的内存空间中。如果原有的位图数据是通过动态分配得到的，
- * 则会释放原有的内存空间。
+ * 则会释放原有的内存空间。挂载了摘要位图时，会为新的位图重新分配摘要位图。
  *
  * @param bitmap 指向位图结构体的指针，包含位图的相关信息。
  * @param expandSize 要扩展到位图的新总位数。
@@ -149,8 +413,12 @@ bool bitmap_Expand(bitmap_t* bitmap, uint32 expandSize)
 {
     // 计算扩展后的新总位数
     uint32 newSize = expandSize;
+    if (newSize <= bitmap->bits)
+    {
+        return true;
+    }
     // 计算扩展后所需的数组元素数量，每个元素可存储 32 位
-    uint32 newArraySize = newSize / 32;
+    uint32 newArraySize = (newSize + 31) / 32;
     // 动态分配新的内存空间，用于存储扩展后的位图数据
     uint32* newArray = (uint32*)kmalloc(newArraySize * sizeof(uint32), NOT_PAGE_ALIGNED);
     // 检查内存分配是否失败
@@ -169,6 +437,16 @@ bool bitmap_Expand(bitmap_t* bitmap, uint32 expandSize)
     {
         newArray[i] = bitmap->array[i];
     }
+    // 原来最后一个字中的填充位现在是有效位，需要清 0
+    if (OFFSET_FROM_BIT(bitmap->bits) != 0)
+    {
+        newArray[bitmap->arraySize - 1] &= bit_Mask(0, OFFSET_FROM_BIT(bitmap->bits));
+    }
+    // 新的最后一个字中的填充位标记为已占用
+    if (OFFSET_FROM_BIT(newSize) != 0)
+    {
+        newArray[newArraySize - 1] |= ~bit_Mask(0, OFFSET_FROM_BIT(newSize));
+    }
     // 检查原有的位图数据是否是通过动态分配得到的
     if (bitmap->allocArray)
     {
@@ -183,6 +461,16 @@ bool bitmap_Expand(bitmap_t* bitmap, uint32 expandSize)
     bitmap->bits = newSize;
     // 标记位图数据是通过动态分配得到的
     bitmap->allocArray = true;
+    // 原有的摘要位图容量可能不足，重新分配
+    if (bitmap->summary != nullptr)
+    {
+        if (bitmap->allocSummary)
+        {
+            kfree(bitmap->summary);
+        }
+        bitmap->summary = nullptr;
+        bitmap_Attach_Summary(bitmap, nullptr);
+    }
     // 扩展成功，返回 true
     return true;
 }
@@ -193,4 +481,43 @@ void bitmap_Destroy(bitmap_t* bitmap)
     {
         kfree(bitmap->array);
     }
+    if (bitmap->allocSummary)
+    {
+        kfree(bitmap->summary);
+    }
+}
+
+void bitmap_Test(void)
+{
+    uint32 array[3];
+    uint32 summary[1];
+    uint32 bit = 0;
+    bitmap_t bitmap = bitmap_Create(array, 70);
+    bitmap_Attach_Summary(&bitmap, summary);
+    bitmap_Set_Range(&bitmap, 0, 33);
+    ASSERT(bitmap_Find_First_Free_Bit(&bitmap, &bit) && bit == 33);
+    ASSERT(bitmap_Allocate_Range(&bitmap, 10, &bit) && bit == 33);
+    ASSERT(bitmap_Allocate_Next_Free_Bit(&bitmap, &bit) && bit == 43);
+    bitmap_Clear_Bit(&bitmap, 5);
+    // next-fit 从上次分配的字继续查找，不会回到低地址的空闲位
+    ASSERT(bitmap_Allocate_Next_Free_Bit(&bitmap, &bit) && bit == 44);
+    ASSERT(bitmap_Allocate_First_Free_Bit(&bitmap, &bit) && bit == 5);
+    // 超出 70 位的部分不能被分配
+    ASSERT(!bitmap_Allocate_Range(&bitmap, 26, &bit));
+    ASSERT(bitmap_Allocate_Range(&bitmap, 25, &bit) && bit == 45);
+    ASSERT(!bitmap_Find_First_Free_Bit(&bitmap, &bit));
+    ASSERT(summary[0] == BITMAP_FULL_WORD);
+    bitmap_Clear_Range(&bitmap, 40, 30);
+    ASSERT(bitmap_Find_Next_Free_Bit(&bitmap, &bit) && bit == 40);
+    // 字数为 32 的整数倍时，在最后一个字之后继续查找不能越过摘要位图
+    uint32 fullArray[32];
+    uint32 fullSummary[1];
+    bitmap_t full = bitmap_Create(fullArray, 1024);
+    bitmap_Attach_Summary(&full, fullSummary);
+    bitmap_Set_Range(&full, 0, 1024);
+    bitmap_Clear_Range(&full, 990, 10);
+    ASSERT(!bitmap_Allocate_Range(&full, 20, &bit));
+    ASSERT(bitmap_Allocate_Range(&full, 10, &bit) && bit == 990);
+    ASSERT(!bitmap_Find_Next_Free_Bit(&full, &bit));
+    monitor_Printf("bitmap_Test over\n");
 }
\ No newline at end of file
@@ -49,11 +49,14 @@ typedef struct bitmap
 {
     uint32* array;  /**< 指向存储位图数据的 32 位无符号整数数组的指针。每个 uint32 元素可存储 32 个比特位。 */
     uint8 allocArray;  /**< 标志位，用于指示 array 所指向的内存是否为动态分配。非零值表示动态分配，零值表示非动态分配。 */
-    int arraySize;  /**< 存储位图数据的数组的元素数量，即 array 数组中 uint32 元素的个数。 */
-    int bits;  /**< 位图中总的比特位数，即该位图可表示的布尔状态数量。 */
+    uint32 arraySize;  /**< 存储位图数据的数组的元素数量，即 array 数组中 uint32 元素的个数。 */
+    uint32 bits;  /**< 位图中总的比特位数，即该位图可表示的布尔状态数量。 */
+    uint32 hint;  /**< next-fit 游标，保存上次分配所在的字下标。 */
+    uint32* summary;  /**< 可选的摘要位图，第 i 位为 1 表示 array[i] 已全满，为 nullptr 时不使用。 */
+    uint8 allocSummary;  /**< 摘要位图是否为动态分配。 */
 } bitmap_t;
 
-bitmap_t bitmap_Create(uint32* array, int numBits);
+bitmap_t bitmap_Create(uint32* array, uint32 numBits);
 void bitmap_Init(bitmap_t* bitmap, uint32* array, uint32 numBits);
 void bitmap_Set_Bit(bitmap_t* bitmap, uint32 bit);
 void bitmap_Clear_Bit(bitmap_t* bitmap, uint32 bit);
@@ -63,5 +66,12 @@ void bitmap_Clear(bitmap_t* bitmap);
 bool bitmap_Allocate_First_Free_Bit(bitmap_t* bitmap, uint32* bit);
 bool bitmap_Expand(bitmap_t* bitmap, uint32 expandSize);
 void bitmap_Destroy(bitmap_t* bitmap);
+bool bitmap_Attach_Summary(bitmap_t* bitmap, uint32* summary);
+void bitmap_Set_Range(bitmap_t* bitmap, uint32 bit, uint32 count);
+void bitmap_Clear_Range(bitmap_t* bitmap, uint32 bit, uint32 count);
+bool bitmap_Find_Next_Free_Bit(bitmap_t* bitmap, uint32* bit);
+bool bitmap_Allocate_Next_Free_Bit(bitmap_t* bitmap, uint32* bit);
+bool bitmap_Allocate_Range(bitmap_t* bitmap, uint32 count, uint32* bit);
+void bitmap_Test(void);
 
 #endif // !BITMAP_H
\ No newline at end of file
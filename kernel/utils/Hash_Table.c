@@ -1,4 +1,15 @@
 #include "Hash_Table.h"
+#include "Slab.h"
+
+static kmem_cache_t* pairCache = nullptr;
+
+/**
+ * @brief 创建键值对缓存，在 kheap_Init 中调用一次，此时还没有其他线程。
+ */
+void hash_Table_Cache_Init(void)
+{
+    pairCache = kmem_Cache_Create("hash_table_pair", sizeof(hash_table_pair_t), nullptr);
+}
 
 
 /**
@@ -50,7 +61,7 @@ static void hash_Table_Expand(hash_table_t* this)
         {
             doubly_linked_list_node_t *cur = node;
             node = node->next;
-            hash_table_pair_t *pair = (hash_table_pair_t *)node->dataPtr;
+            hash_table_pair_t *pair = (hash_table_pair_t *)cur->dataPtr;
             doubly_Linked_List_Remove(bucket, cur);
             uint32 key = pair->key;
             doubly_Linked_List_Append(&newBuckets[key % newBucketsNum], cur);
@@ -83,17 +94,17 @@ void hash_Table_Clear(hash_table_t *table)
 {
     for (int32 i = 0; i < table->bucketsNum; i++)
     {
-        doubly_linked_list_t bucket = table->buckets[i];
-        doubly_linked_list_node_t *node = bucket.head;
+        doubly_linked_list_t *bucket = &table->buckets[i];
+        doubly_linked_list_node_t *node = bucket->head;
         while (node != NULL)
         {
             doubly_linked_list_node_t *cur = node;
             node = node->next;
             hash_table_pair_t *pair = (hash_table_pair_t *)cur->dataPtr;
             kfree(pair->value);
-            kfree(pair);
-            doubly_Linked_List_Remove(&bucket, cur);
-            kfree(cur);
+            kmem_Cache_Free(pairCache, pair);
+            doubly_Linked_List_Remove(bucket, cur);
+            doubly_Linked_List_Node_Free(cur);
         }
     }
     table->size = 0;
@@ -140,10 +151,21 @@ void* hash_Table_Put(hash_table_t* this, uint32 key, void* value)
         pair->value = value;
         return oldValue;
     }
-    hash_table_pair_t* newPair = (hash_table_pair_t*)kmalloc(sizeof(hash_table_pair_t), NOT_PAGE_ALIGNED);
+    ASSERT(pairCache != nullptr);
+    hash_table_pair_t* newPair = (hash_table_pair_t*)kmem_Cache_Alloc(pairCache);
+    if (newPair == nullptr)
+    {
+        monitor_Printf("hash_Table_Put: out of memory, key %x not inserted\n", key);
+        return nullptr;
+    }
     newPair->key = key;
     newPair->value = value;
-    doubly_Linked_List_Append_Data(bucket, newPair);
+    if (!doubly_Linked_List_Append_Data(bucket, newPair))
+    {
+        kmem_Cache_Free(pairCache, newPair);
+        monitor_Printf("hash_Table_Put: out of memory, key %x not inserted\n", key);
+        return nullptr;
+    }
     this->size++;
     if (this->size > this->bucketsNum * LOAD_FACTOR)
     {
@@ -160,8 +182,8 @@ void* hash_Table_Remove(hash_table_t* this, uint32 key)
         doubly_Linked_List_Remove(bucket, node);
         hash_table_pair_t* pair = (hash_table_pair_t*)node->dataPtr;
         void* value = pair->value;
-        kfree(pair);
-        kfree(node);
+        kmem_Cache_Free(pairCache, pair);
+        doubly_Linked_List_Node_Free(node);
         this->size--;
 
         // TODO: shrink buckets if needed?
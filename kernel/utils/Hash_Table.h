@@ -38,6 +38,7 @@ hash_table_interator_t hash_Table_Iterator_Init(hash_table_t* map);
 void* hash_Table_Remove(hash_table_t* this, uint32 key);
 void hash_Table_Insert(hash_table_t* this, uint32 key, void* value);
 void* hash_Table_Get(hash_table_t* this, uint32 key);
+void hash_Table_Cache_Init(void);
 void hash_Table_Init(hash_table_t *table);
 void hash_Table_Destroy(hash_table_t* this);
 
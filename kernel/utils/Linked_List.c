@@ -28,6 +28,36 @@
 ******************************************************************************/
 
 #include "Linked_List.h"
+#include "Slab.h"
+
+static kmem_cache_t* listNodeCache = nullptr;
+
+/**
+ * @brief 创建链表节点缓存，在 kheap_Init 中调用一次，此时还没有其他线程。
+ */
+void doubly_Linked_List_Cache_Init(void)
+{
+    listNodeCache = kmem_Cache_Create("list_node", sizeof(doubly_linked_list_node_t), nullptr);
+}
+
+/**
+ * @brief 从链表节点缓存中分配一个节点。
+ *
+ * 链表节点（包括调度器使用的 thread_node_t）分配和释放非常频繁，
+ * 因此使用专门的 slab 缓存，而不是通用的内核堆。
+ *
+ * @return doubly_linked_list_node_t* 新分配的节点，slab 内存耗尽时返回 nullptr，调用者必须检查。
+ */
+doubly_linked_list_node_t* doubly_Linked_List_Node_Alloc(void)
+{
+    ASSERT(listNodeCache != nullptr);
+    return (doubly_linked_list_node_t*)kmem_Cache_Alloc(listNodeCache);
+}
+
+void doubly_Linked_List_Node_Free(doubly_linked_list_node_t *node)
+{
+    kmem_Cache_Free(listNodeCache, node);
+}
 
 void doubly_Linked_List_Init(doubly_linked_list_t *list)
 {
@@ -178,11 +208,21 @@ void doubly_Linked_List_Remove(doubly_linked_list_t *list, doubly_linked_list_no
     list->size--;
 }
 
-void doubly_Linked_List_Append_Data(doubly_linked_list_t *list, void *dataPtr)
+/**
+ * @brief 分配一个节点保存 dataPtr 并追加到链表尾部。
+ *
+ * @return bool 无法分配节点时返回 false，链表保持不变。
+ */
+bool doubly_Linked_List_Append_Data(doubly_linked_list_t *list, void *dataPtr)
 {
-    doubly_linked_list_node_t* node = (doubly_linked_list_node_t*)kmalloc(sizeof(doubly_linked_list_node_t), NOT_PAGE_ALIGNED);
+    doubly_linked_list_node_t* node = doubly_Linked_List_Node_Alloc();
+    if (node == nullptr)
+    {
+        return false;
+    }
     node->dataPtr = (void*)dataPtr;
     doubly_Linked_List_Append(list, node);
+    return true;
 }
 
 void doubly_Linked_List_Remove_Data(doubly_linked_list_t *list, void *dataPtr)
@@ -48,6 +48,9 @@ struct doubly_linked_list {
 } __attribute__((packed));
 typedef struct doubly_linked_list doubly_linked_list_t;
 
+void doubly_Linked_List_Cache_Init(void);
+doubly_linked_list_node_t* doubly_Linked_List_Node_Alloc(void);
+void doubly_Linked_List_Node_Free(doubly_linked_list_node_t *node);
 void doubly_Linked_List_Init(doubly_linked_list_t *list);
 doubly_linked_list_t create_Doubly_Linked_List(void);
 void doubly_Linked_List_Move(doubly_linked_list_t *dst, doubly_linked_list_t *src);
@@ -57,6 +60,6 @@ void doubly_Linked_List_Insert(doubly_linked_list_t *list, doubly_linked_list_no
 void doubly_Linked_List_Insert_Head(doubly_linked_list_t *list, doubly_linked_list_node_t *node);
 void doubly_Linked_List_Remove(doubly_linked_list_t *list, doubly_linked_list_node_t *node);
 void doubly_Linked_List_Remove_Data(doubly_linked_list_t *list, void *dataPtr);
-void doubly_Linked_List_Append_Data(doubly_linked_list_t *list, void *dataPtr);
+bool doubly_Linked_List_Append_Data(doubly_linked_list_t *list, void *dataPtr);
 void doubly_Linked_Test();
 #endif // !LINKED_LIST_H
\ No newline at end of file
@@ -68,4 +68,51 @@ uint32 max(uint32 a, uint32 b)
 uint32 min(uint32 a, uint32 b)
 {
     return a < b? a : b;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 查找最低位的 1（bsf 指令）。
+ * @param value 待查找的值。
+ * @return 最低位 1 的位置，value 为 0 时返回 -1。
+ */
+int32 bit_Scan_Forward(uint32 value)
+{
+    if (value == 0)
+    {
+        return -1;
+    }
+    uint32 index;
+    asm volatile("bsf %1, %0" : "=r"(index) : "rm"(value));
+    return (int32)index;
+}
+
+/**
+ * @brief 查找最高位的 1（bsr 指令）。
+ * @param value 待查找的值。
+ * @return 最高位 1 的位置，value 为 0 时返回 -1。
+ */
+int32 bit_Scan_Reverse(uint32 value)
+{
+    if (value == 0)
+    {
+        return -1;
+    }
+    uint32 index;
+    asm volatile("bsr %1, %0" : "=r"(index) : "rm"(value));
+    return (int32)index;
+}
+
+/**
+ * @brief 64 位无符号数除以 32 位无符号数（divl 指令），内核不链接 libgcc，不能直接使用 64 位除法。
+ * @param dividend 被除数。
+ * @param divisor 除数，商必须能用 32 位表示，否则触发除法错误。
+ * @return 商。
+ */
+uint32 div_U64_U32(uint64 dividend, uint32 divisor)
+{
+    uint32 quotient;
+    uint32 remainder;
+    asm volatile("divl %4" : "=a"(quotient), "=d"(remainder)
+        : "a"((uint32)dividend), "d"((uint32)(dividend >> 32)), "rm"(divisor));
+    return quotient;
+}
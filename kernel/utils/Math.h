@@ -35,4 +35,7 @@ int32 div(int32 x, int32 n);
 int32 mod(int32 x, int32 n);
 uint32 max(uint32 a, uint32 b);
 uint32 min(uint32 a, uint32 b);
+int32 bit_Scan_Forward(uint32 value);
+int32 bit_Scan_Reverse(uint32 value);
+uint32 div_U64_U32(uint64 dividend, uint32 divisor);
 #endif
\ No newline at end of file
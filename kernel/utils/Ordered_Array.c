@@ -28,6 +28,7 @@
 ******************************************************************************/
 
 #include "Ordered_Array.h"
+#include "Debug.h"
 
 int32 standard_Compare(void *a, void *b)
 {
@@ -44,60 +45,218 @@ ordered_array_t ordered_Array_Create(void* array, uint32 maxSize, comparator_t c
     return orderedArray;
 }
 
-ordered_array_return_t ordered_Array_Insert(ordered_array_t *orderedArray, void *element)
+/**
+ * @brief 二分查找第一个不小于 element 的元素位置。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param element 用于比较的元素。
+ * @return uint32 第一个满足 comparator(array[i], element) >= 0 的位置，不存在时返回 size。
+ */
+uint32 ordered_Array_Lower_Bound(ordered_array_t *orderedArray, void *element)
 {
-    if (orderedArray->size >= orderedArray->maxSize)
+    uint32 low = 0;
+    uint32 high = orderedArray->size;
+    while (low < high)
     {
-        return OUT_OF_RANGE;
+        uint32 mid = low + (high - low) / 2;
+        if (orderedArray->comparator(orderedArray->array[mid], element) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
-    uint32 i = 0;
-    while (i < orderedArray->size && orderedArray->comparator(orderedArray->array[i], element) <= 0)
+    return low;
+}
+
+/**
+ * @brief 二分查找第一个大于 element 的元素位置。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param element 用于比较的元素。
+ * @return uint32 第一个满足 comparator(array[i], element) > 0 的位置，不存在时返回 size。
+ */
+uint32 ordered_Array_Upper_Bound(ordered_array_t *orderedArray, void *element)
+{
+    uint32 low = 0;
+    uint32 high = orderedArray->size;
+    while (low < high)
     {
-        i++;
+        uint32 mid = low + (high - low) / 2;
+        if (orderedArray->comparator(orderedArray->array[mid], element) <= 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
     }
-    orderedArray->size++;
-    for (uint32 j = orderedArray->size - 1; j > i; j--)
+    return low;
+}
+
+/**
+ * @brief 在指定位置插入元素，调用者需要保证插入后数组仍然有序。
+ *
+ * 通常与 ordered_Array_Lower_Bound / ordered_Array_Upper_Bound 配合使用。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param index 插入位置，取值范围为 0 到 size。
+ * @param element 要插入的元素。
+ * @return ordered_array_return_t 数组已满或位置越界时返回 OUT_OF_RANGE。
+ */
+ordered_array_return_t ordered_Array_Insert_At(ordered_array_t *orderedArray, uint32 index, void *element)
+{
+    if (orderedArray->size >= orderedArray->maxSize || index > orderedArray->size)
+    {
+        return OUT_OF_RANGE;
+    }
+    for (uint32 j = orderedArray->size; j > index; j--)
     {
         orderedArray->array[j] = orderedArray->array[j - 1];
     }
-    orderedArray->array[i] = element;
+    orderedArray->array[index] = element;
+    orderedArray->size++;
     return OK;
 }
 
+ordered_array_return_t ordered_Array_Insert(ordered_array_t *orderedArray, void *element)
+{
+    // 插入到相等元素之后，保持相等元素的插入顺序
+    return ordered_Array_Insert_At(orderedArray, ordered_Array_Upper_Bound(orderedArray, element), element);
+}
+
 ordered_array_return_t ordered_Array_Remove(ordered_array_t *orderedArray, void *element)
 {
     if (orderedArray->size == 0)
     {
         return OUT_OF_RANGE;
     }
-    uint32 i = 0;
-    while (i < orderedArray->size && orderedArray->comparator(orderedArray->array[i], element) != 0)
-    {
-        i++;
-    }
+    uint32 i = ordered_Array_Search(orderedArray, element);
     if (i == orderedArray->size)
     {
         return 0;
     }
-    for (uint32 j = i; j < orderedArray->size - 1; j++)
+    return ordered_Array_Remove_Index(orderedArray, i);
+}
+
+uint32 ordered_Array_Search(ordered_array_t *orderedArray, void *element)
+{
+    uint32 index = ordered_Array_Lower_Bound(orderedArray, element);
+    if (index < orderedArray->size && orderedArray->comparator(orderedArray->array[index], element) == 0)
     {
-        orderedArray->array[j] = orderedArray->array[j + 1];
+        return index;
     }
-    orderedArray->size--;
-    return OK;
+    return orderedArray->size;
 }
 
-uint32 ordered_Array_Search(ordered_array_t *orderedArray, void *element)
+/**
+ * @brief 按指针精确查找元素的位置。
+ *
+ * 比较函数相等的元素可能有多个，先二分定位到相等区间，再在区间内按地址区分。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param element 要查找的元素指针。
+ * @return uint32 元素所在的位置，未找到时返回 size。
+ */
+uint32 ordered_Array_Find(ordered_array_t *orderedArray, void *element)
 {
-    uint32 index = orderedArray->size;
-    for (uint32 i = 0; i < orderedArray->size; i++)
+    for (uint32 i = ordered_Array_Lower_Bound(orderedArray, element); i < orderedArray->size; i++)
     {
-        if (orderedArray->comparator(orderedArray->array[i], element) == 0)
+        if (orderedArray->array[i] == element)
+        {
+            return i;
+        }
+        if (orderedArray->comparator(orderedArray->array[i], element) != 0)
         {
-            index = i;
             break;
         }
     }
+    return orderedArray->size;
+}
+
+ordered_array_return_t ordered_Array_Remove_Exact(ordered_array_t *orderedArray, void *element)
+{
+    return ordered_Array_Remove_Index(orderedArray, ordered_Array_Find(orderedArray, element));
+}
+
+/**
+ * @brief 一次性插入多个元素。
+ *
+ * 先对待插入的元素做插入排序（数量通常很少），再从数组尾部开始归并，
+ * 每个已有元素最多移动一次，代价为 O(size + count^2)，
+ * 而逐个插入的代价为 O(size * count)。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param elements 待插入的元素数组，函数返回后其中的元素会被排序。
+ * @param count 待插入的元素数量。
+ * @return ordered_array_return_t 剩余容量不足时返回 OUT_OF_RANGE，数组保持不变。
+ */
+ordered_array_return_t ordered_Array_Insert_Bulk(ordered_array_t *orderedArray, void **elements, uint32 count)
+{
+    if (count > orderedArray->maxSize - orderedArray->size)
+    {
+        return OUT_OF_RANGE;
+    }
+    for (uint32 i = 1; i < count; i++)
+    {
+        void *element = elements[i];
+        uint32 j = i;
+        while (j > 0 && orderedArray->comparator(elements[j - 1], element) > 0)
+        {
+            elements[j] = elements[j - 1];
+            j--;
+        }
+        elements[j] = element;
+    }
+    // 从尾部归并，相等时已有元素排在前面，与 ordered_Array_Insert 的顺序一致
+    uint32 i = orderedArray->size;
+    uint32 j = count;
+    uint32 k = orderedArray->size + count;
+    while (j > 0)
+    {
+        if (i > 0 && orderedArray->comparator(orderedArray->array[i - 1], elements[j - 1]) > 0)
+        {
+            orderedArray->array[--k] = orderedArray->array[--i];
+        }
+        else
+        {
+            orderedArray->array[--k] = elements[--j];
+        }
+    }
+    orderedArray->size += count;
+    return OK;
+}
+
+/**
+ * @brief 元素的排序键发生变化后，将其移动到正确的位置。
+ *
+ * 只移动原位置和新位置之间的元素，比先删除再插入少一半的搬移量。
+ *
+ * @param orderedArray 指向有序数组的指针。
+ * @param index 排序键发生变化的元素位置。
+ * @return uint32 元素的新位置，index 越界时返回 size。
+ */
+uint32 ordered_Array_Reposition(ordered_array_t *orderedArray, uint32 index)
+{
+    if (index >= orderedArray->size)
+    {
+        return orderedArray->size;
+    }
+    void *element = orderedArray->array[index];
+    while (index > 0 && orderedArray->comparator(orderedArray->array[index - 1], element) > 0)
+    {
+        orderedArray->array[index] = orderedArray->array[index - 1];
+        index--;
+    }
+    while (index + 1 < orderedArray->size && orderedArray->comparator(orderedArray->array[index + 1], element) <= 0)
+    {
+        orderedArray->array[index] = orderedArray->array[index + 1];
+        index++;
+    }
+    orderedArray->array[index] = element;
     return index;
 }
 
@@ -126,13 +285,29 @@ ordered_array_return_t ordered_Array_Remove_Index(ordered_array_t *orderedArray,
 
 void ordered_Array_Test()
 {
-    uint32 array[11] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
-    uint32 element = 11;
-    ordered_array_t orderedArray = ordered_Array_Create(array, 11, standard_Compare);
-    monitor_Printf("orderedArray.array[9] = %d\n", orderedArray.array[9]);
-    ordered_Array_Insert(&orderedArray, (void*)element);
-    monitor_Printf("insert over\n");
-    monitor_Printf("orderedArray.array[0] = %d\n", orderedArray.array[0]);
-    ordered_Array_Remove(&orderedArray, (void*)element);
-    monitor_Printf("orderedArray.array[0] = %d\n", orderedArray.array[0]);
+    int32 values[8] = {10, 20, 20, 30, 40, 15, 25, 20};
+    void* storage[8];
+    ordered_array_t orderedArray = ordered_Array_Create(storage, 8, standard_Compare);
+    for (uint32 i = 0; i < 5; i++)
+    {
+        ordered_Array_Insert(&orderedArray, &values[i]);
+    }
+    ASSERT(ordered_Array_Lower_Bound(&orderedArray, &values[1]) == 1);
+    ASSERT(ordered_Array_Upper_Bound(&orderedArray, &values[1]) == 3);
+    // 相等的元素按地址区分
+    ASSERT(ordered_Array_Find(&orderedArray, &values[2]) == 2);
+    ASSERT(ordered_Array_Find(&orderedArray, &values[7]) == orderedArray.size);
+    ordered_Array_Remove_Exact(&orderedArray, &values[1]);
+    ASSERT(ordered_Array_Get(&orderedArray, 1) == &values[2]);
+    void* bulk[3] = {&values[6], &values[5], &values[7]};
+    ordered_Array_Insert_Bulk(&orderedArray, bulk, 3);
+    ASSERT(orderedArray.size == 7);
+    for (uint32 i = 1; i < orderedArray.size; i++)
+    {
+        ASSERT(standard_Compare(orderedArray.array[i - 1], orderedArray.array[i]) <= 0);
+    }
+    values[0] = 35;
+    uint32 index = ordered_Array_Reposition(&orderedArray, 0);
+    ASSERT(orderedArray.array[index] == &values[0] && index == 5);
+    monitor_Printf("ordered_Array_Test over\n");
 }
@@ -78,5 +78,12 @@ ordered_array_return_t ordered_Array_Remove(ordered_array_t *orderedArray, void
 uint32 ordered_Array_Search(ordered_array_t *orderedArray, void *element);
 void* ordered_Array_Get(ordered_array_t *orderedArray, uint32 index);
 ordered_array_return_t ordered_Array_Remove_Index(ordered_array_t *orderedArray, uint32 index);
+uint32 ordered_Array_Lower_Bound(ordered_array_t *orderedArray, void *element);
+uint32 ordered_Array_Upper_Bound(ordered_array_t *orderedArray, void *element);
+ordered_array_return_t ordered_Array_Insert_At(ordered_array_t *orderedArray, uint32 index, void *element);
+uint32 ordered_Array_Find(ordered_array_t *orderedArray, void *element);
+ordered_array_return_t ordered_Array_Remove_Exact(ordered_array_t *orderedArray, void *element);
+ordered_array_return_t ordered_Array_Insert_Bulk(ordered_array_t *orderedArray, void **elements, uint32 count);
+uint32 ordered_Array_Reposition(ordered_array_t *orderedArray, uint32 index);
 void ordered_Array_Test();
 #endif
\ No newline at end of file